@@ -111,12 +111,9 @@ uint64_t GetFileSize(const std::wstring& path) {
 
 uint64_t GetFolderSize(const std::wstring& path, bool recursive) {
   uint64_t folder_size = 0;
-  const auto max_dword = static_cast<uint64_t>(MAXDWORD) + 1;
 
   const auto on_file = [&](const base::FileSearchResult& result) {
-    folder_size +=
-        static_cast<uint64_t>(result.data.nFileSizeHigh) * max_dword +
-        static_cast<uint64_t>(result.data.nFileSizeLow);
+    folder_size += result.size;
     return false;
   };
 
@@ -424,6 +421,54 @@ bool ReadFromFile(const std::wstring& path, std::string& output) {
   return result != FALSE && bytes_read == output.size();
 }
 
+FileMapping::~FileMapping() {
+  Close();
+}
+
+bool FileMapping::Open(const std::wstring& path) {
+  Close();
+
+  file_ = OpenFileForGenericRead(path);
+  if (file_ == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size{};
+  if (::GetFileSizeEx(file_, &file_size) == FALSE || !file_size.QuadPart) {
+    Close();
+    return false;
+  }
+
+  mapping_ = ::CreateFileMapping(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_) {
+    Close();
+    return false;
+  }
+
+  data_ = static_cast<const char*>(
+      ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    Close();
+    return false;
+  }
+
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void FileMapping::Close() {
+  if (data_)
+    ::UnmapViewOfFile(data_);
+  if (mapping_)
+    ::CloseHandle(mapping_);
+  if (file_ != INVALID_HANDLE_VALUE)
+    ::CloseHandle(file_);
+
+  file_ = INVALID_HANDLE_VALUE;
+  mapping_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+}
+
 bool SaveToFile(LPCVOID data, DWORD length, const std::wstring& path,
                 bool take_backup) {
   // Make sure the path is available
@@ -61,6 +61,28 @@ unsigned int PopulateFiles(std::vector<std::wstring>& file_list,
                            bool recursive = false, bool trim_extension = false);
 
 bool ReadFromFile(const std::wstring& path, std::string& output);
+
+// Maps the contents of a file into memory for reading
+class FileMapping {
+public:
+  FileMapping() = default;
+  FileMapping(const FileMapping&) = delete;
+  FileMapping& operator=(const FileMapping&) = delete;
+  ~FileMapping();
+
+  bool Open(const std::wstring& path);
+  void Close();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
 bool SaveToFile(LPCVOID data, DWORD length, const std::wstring& path,
                 bool take_backup = false);
 bool SaveToFile(const std::string& data, const std::wstring& path,
@@ -16,29 +16,34 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <limits>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <set>
-
-#include <windows/win/error.h>
+#include <thread>
+#include <vector>
 
 #include "base/file_search.h"
 
-#include "base/file.h"
-#include "base/log.h"
-#include "base/string.h"
-
 namespace base {
 
-struct FileSearchHandleDeleter {
-  using pointer = HANDLE;
-  void operator()(pointer p) const { ::FindClose(p); }
-};
-
-using FileSearchHandle = std::unique_ptr<HANDLE, FileSearchHandleDeleter>;
-
-constexpr uint64_t GetFileSize(const WIN32_FIND_DATA& data) {
-  constexpr auto m = std::numeric_limits<decltype(data.nFileSizeLow)>::max();
-  return (data.nFileSizeHigh * (m + 1ull)) + data.nFileSizeLow;
+// Calls `on_entry` for each entry of the directory that passes the options,
+// and returns true as soon as it does.
+template <typename Function>
+static bool ReadDirectory(const std::wstring& root,
+                          const FileSearchOptions& options,
+                          Function&& on_entry) {
+  return detail::ReadDirectory(root, options.log_errors,
+      [&](const FileSearchResult& result) {
+        if (!result.is_directory) {
+          if (options.skip_files)
+            return false;
+          if (result.size < options.min_file_size)
+            return false;
+        }
+        return on_entry(result);
+      });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -52,47 +57,26 @@ bool FileSearch::Search(const std::wstring& root,
   if (options.skip_directories && options.skip_files)
     return false;
 
-  const auto path = AddTrailingSlash(GetExtendedLengthPath(root)) + L"*";
-  std::set<std::wstring> subdirectories;
-
-  WIN32_FIND_DATA data;
-  FileSearchHandle handle(::FindFirstFile(path.c_str(), &data));
+  // Only subdirectories are read in parallel
+  if (options.thread_count > 1 && !options.skip_subdirectories)
+    return SearchParallel(root, on_directory, on_file);
 
-  do {
-    if (handle.get() == INVALID_HANDLE_VALUE) {
-      if (options.log_errors) {
-        auto error_message = win::FormatError(::GetLastError());
-        TrimRight(error_message, L"\r\n");
-        LOGE(L"{}\nPath: {}", error_message, path);
-      }
-      ::SetLastError(ERROR_SUCCESS);
-      continue;
-    }
-
-    if (IsSystemFile(data) || IsHiddenFile(data))
-      continue;
+  std::set<std::wstring> subdirectories;
 
-    // Directory
-    if (IsDirectory(data)) {
-      if (!IsValidDirectory(data))
-        continue;
+  const auto on_entry = [&](const FileSearchResult& result) {
+    if (result.is_directory) {
       if (!options.skip_directories)
-        if (on_directory && on_directory({root, data.cFileName, data}))
+        if (on_directory && on_directory(result))
           return true;
       if (!options.skip_subdirectories)
-        subdirectories.insert(AddTrailingSlash(root) + data.cFileName);
-
-    // File
-    } else {
-      if (options.skip_files)
-        continue;
-      if (GetFileSize(data) < options.min_file_size)
-        continue;
-      if (on_file && on_file({root, data.cFileName, data}))
-        return true;
+        subdirectories.insert(detail::GetSubdirectoryPath(root, result.name));
+      return false;
     }
+    return on_file && on_file(result);
+  };
 
-  } while (::FindNextFile(handle.get(), &data));
+  if (ReadDirectory(root, options, on_entry))
+    return true;
 
   for (const auto& subdirectory : subdirectories) {
     if (Search(subdirectory, on_directory, on_file))
@@ -102,4 +86,198 @@ bool FileSearch::Search(const std::wstring& root,
   return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Directories are read by a fixed number of workers, each of which has its
+// own queue. Workers take directories from the back of their own queue, which
+// keeps them close to where they were, and steal from the front of the other
+// queues when theirs is empty. Entries are passed to the calling thread in
+// batches, so that the callbacks don't need to be thread-safe.
+class ParallelSearch {
+public:
+  using batch_t = std::vector<FileSearchResult>;
+
+  ParallelSearch(const FileSearchOptions& options, size_t thread_count)
+      : options_{options}, queues_(thread_count) {}
+
+  void Start(const std::wstring& root) {
+    PushDirectory(0, root);
+    threads_.reserve(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      threads_.emplace_back([this, i]() { Work(i); });
+    }
+  }
+
+  // Returns false after all directories are read and all batches are taken
+  bool PopBatch(batch_t& batch) {
+    std::unique_lock lock{mutex_};
+    batch_available_.wait(lock, [this]() {
+      return !batches_.empty() || !pending_directories_;
+    });
+    if (batches_.empty())
+      return false;
+    batch = std::move(batches_.front());
+    batches_.pop_front();
+    lock.unlock();
+    batch_taken_.notify_one();
+    return true;
+  }
+
+  void Stop() {
+    {
+      std::lock_guard lock{mutex_};
+      stopped_ = true;
+    }
+    work_available_.notify_all();
+    batch_taken_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+private:
+  // Bounds the memory that is used when the callbacks are slower than reading
+  static constexpr size_t kBatchSize = 256;
+  static constexpr size_t kMaxBatches = 64;
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::wstring> directories;
+  };
+
+  void Work(size_t index) {
+    while (!stopped_) {
+      std::wstring directory;
+      if (!PopDirectory(index, directory)) {
+        std::unique_lock lock{mutex_};
+        work_available_.wait(lock, [this]() {
+          return stopped_ || !pending_directories_ || queued_directories_;
+        });
+        if (stopped_ || !pending_directories_)
+          return;
+        continue;
+      }
+
+      batch_t batch;
+
+      ReadDirectory(directory, options_,
+          [&](const FileSearchResult& result) {
+            if (stopped_)
+              return true;
+            if (result.is_directory) {
+              if (!options_.skip_subdirectories)
+                PushDirectory(index, detail::GetSubdirectoryPath(directory,
+                                                                 result.name));
+              if (options_.skip_directories)
+                return false;
+            }
+            batch.push_back(result);
+            if (batch.size() >= kBatchSize)
+              PushBatch(batch);
+            return false;
+          });
+
+      if (!batch.empty())
+        PushBatch(batch);
+
+      // The last directory wakes up everyone who waits for more work
+      std::lock_guard lock{mutex_};
+      if (!--pending_directories_) {
+        work_available_.notify_all();
+        batch_available_.notify_all();
+      }
+    }
+  }
+
+  void PushDirectory(size_t index, std::wstring directory) {
+    {
+      std::lock_guard lock{mutex_};
+      ++pending_directories_;
+    }
+    {
+      auto& queue = queues_[index];
+      std::lock_guard lock{queue.mutex};
+      queue.directories.push_back(std::move(directory));
+    }
+    {
+      std::lock_guard lock{mutex_};
+      ++queued_directories_;
+    }
+    work_available_.notify_one();
+  }
+
+  bool PopDirectory(size_t index, std::wstring& directory) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      auto& queue = queues_[(index + i) % queues_.size()];
+      std::lock_guard lock{queue.mutex};
+      if (queue.directories.empty())
+        continue;
+      if (!i) {
+        directory = std::move(queue.directories.back());
+        queue.directories.pop_back();
+      } else {
+        directory = std::move(queue.directories.front());
+        queue.directories.pop_front();
+      }
+      std::lock_guard counter_lock{mutex_};
+      --queued_directories_;
+      return true;
+    }
+    return false;
+  }
+
+  void PushBatch(batch_t& batch) {
+    std::unique_lock lock{mutex_};
+    batch_taken_.wait(lock, [this]() {
+      return stopped_ || batches_.size() < kMaxBatches;
+    });
+    if (!stopped_)
+      batches_.push_back(std::move(batch));
+    batch.clear();
+    lock.unlock();
+    batch_available_.notify_one();
+  }
+
+  const FileSearchOptions& options_;
+  std::vector<Queue> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable batch_available_;
+  std::condition_variable batch_taken_;
+  std::deque<batch_t> batches_;
+  size_t pending_directories_ = 0;  // queued or being read
+  size_t queued_directories_ = 0;
+  std::atomic_bool stopped_ = false;
+};
+
+}  // namespace
+
+bool FileSearch::SearchParallel(const std::wstring& root,
+                                const callback_function_t& on_directory,
+                                const callback_function_t& on_file) const {
+  ParallelSearch search{options, options.thread_count};
+  search.Start(root);
+
+  bool found = false;
+
+  ParallelSearch::batch_t batch;
+  while (!found && search.PopBatch(batch)) {
+    for (const auto& result : batch) {
+      const auto& callback = result.is_directory ? on_directory : on_file;
+      if (callback && callback(result)) {
+        found = true;
+        break;
+      }
+    }
+  }
+
+  search.Stop();
+
+  return found;
+}
+
 }  // namespace base
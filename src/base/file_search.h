@@ -19,11 +19,10 @@
 #pragma once
 
 #include <cstdint>
+#include <ctime>
 #include <functional>
 #include <string>
 
-#include <windows.h>
-
 namespace base {
 
 struct FileSearchOptions {
@@ -32,12 +31,19 @@ struct FileSearchOptions {
   bool skip_files = false;
   bool skip_subdirectories = false;
   uint64_t min_file_size = 0;
+  // Subdirectories are read by this many threads, while the callbacks are
+  // still called from the calling thread. The order of results is not
+  // defined when there is more than one thread.
+  size_t thread_count = 1;
 };
 
 struct FileSearchResult {
   std::wstring root;
   std::wstring name;
-  WIN32_FIND_DATA data;
+  uint64_t size = 0;
+  time_t last_write_time = 0;
+  bool is_directory = false;
+  bool is_read_only = false;
 };
 
 class FileSearch {
@@ -49,6 +55,27 @@ public:
               callback_function_t on_file) const;
 
   FileSearchOptions options;
+
+private:
+  bool SearchParallel(const std::wstring& root,
+                      const callback_function_t& on_directory,
+                      const callback_function_t& on_file) const;
 };
 
+namespace detail {
+
+// These are implemented separately for each platform, in file_search_win.cpp
+// and file_search_posix.cpp.
+
+// Calls `on_entry` for each entry of the directory, except for hidden and
+// system files, and returns true as soon as it does. The same result is
+// reused for all entries.
+bool ReadDirectory(const std::wstring& root, bool log_errors,
+                   const FileSearch::callback_function_t& on_entry);
+
+std::wstring GetSubdirectoryPath(const std::wstring& root,
+                                 const std::wstring& name);
+
+}  // namespace detail
+
 }  // namespace base
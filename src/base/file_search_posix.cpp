@@ -0,0 +1,162 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/file_search.h"
+
+#include "base/log.h"
+
+namespace base::detail {
+
+// Paths are assumed to be UTF-8 encoded, and wchar_t to hold UTF-32 code
+// points. Invalid sequences are replaced with U+FFFD.
+
+static std::string ToUtf8(const std::wstring& str) {
+  std::string output;
+  output.reserve(str.size());
+
+  for (const auto c : str) {
+    const auto cp = static_cast<uint32_t>(c);
+    if (cp < 0x80) {
+      output.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      output.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      output.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      output.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+
+  return output;
+}
+
+static void FromUtf8(const char* str, std::wstring& output) {
+  constexpr wchar_t kReplacement = 0xFFFD;
+
+  output.clear();
+
+  const auto* p = reinterpret_cast<const unsigned char*>(str);
+
+  while (*p) {
+    uint32_t cp = *p;
+    int length = 0;
+    if (cp < 0x80) {
+      length = 0;
+    } else if ((cp & 0xE0) == 0xC0) {
+      cp &= 0x1F;
+      length = 1;
+    } else if ((cp & 0xF0) == 0xE0) {
+      cp &= 0x0F;
+      length = 2;
+    } else if ((cp & 0xF8) == 0xF0) {
+      cp &= 0x07;
+      length = 3;
+    } else {
+      output.push_back(kReplacement);
+      ++p;
+      continue;
+    }
+    ++p;
+    int i = 0;
+    for (; i < length && (*p & 0xC0) == 0x80; ++i, ++p) {
+      cp = (cp << 6) | (*p & 0x3F);
+    }
+    output.push_back(i == length ? static_cast<wchar_t>(cp) : kReplacement);
+  }
+}
+
+struct DirectoryDeleter {
+  void operator()(DIR* p) const { ::closedir(p); }
+};
+
+using Directory = std::unique_ptr<DIR, DirectoryDeleter>;
+
+bool ReadDirectory(const std::wstring& root, bool log_errors,
+                   const FileSearch::callback_function_t& on_entry) {
+  const auto path = ToUtf8(root);
+
+  Directory directory{::opendir(path.c_str())};
+
+  if (!directory) {
+    if (log_errors) {
+      std::wstring error_message;
+      FromUtf8(std::strerror(errno), error_message);
+      LOGE(L"{}\nPath: {}", error_message, root);
+    }
+    return false;
+  }
+
+  const int directory_fd = ::dirfd(directory.get());
+
+  FileSearchResult result;
+  result.root = root;
+
+  while (const auto entry = ::readdir(directory.get())) {
+    // Names that start with a dot are hidden, including "." and ".."
+    if (entry->d_name[0] == '.')
+      continue;
+
+    // Symbolic links to files are followed, but links to directories are not,
+    // as they can form cycles
+    struct stat st;
+    if (::fstatat(directory_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+    if (S_ISLNK(st.st_mode)) {
+      if (::fstatat(directory_fd, entry->d_name, &st, 0) != 0 ||
+          !S_ISREG(st.st_mode))
+        continue;
+    }
+    const bool is_directory = S_ISDIR(st.st_mode);
+    if (!is_directory && !S_ISREG(st.st_mode))
+      continue;
+
+    FromUtf8(entry->d_name, result.name);
+    result.size = is_directory ? 0 : static_cast<uint64_t>(st.st_size);
+    result.last_write_time = st.st_mtime;
+    result.is_directory = is_directory;
+    result.is_read_only = (st.st_mode & S_IWUSR) == 0;
+
+    if (on_entry(result))
+      return true;
+  }
+
+  return false;
+}
+
+std::wstring GetSubdirectoryPath(const std::wstring& root,
+                                 const std::wstring& name) {
+  if (!root.empty() && root.back() == L'/')
+    return root + name;
+  return root + L'/' + name;
+}
+
+}  // namespace base::detail
@@ -0,0 +1,100 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits>
+
+#include <windows/win/error.h>
+
+#include "base/file_search.h"
+
+#include "base/file.h"
+#include "base/log.h"
+#include "base/string.h"
+
+namespace base::detail {
+
+struct FileSearchHandleDeleter {
+  using pointer = HANDLE;
+  void operator()(pointer p) const { ::FindClose(p); }
+};
+
+using FileSearchHandle = std::unique_ptr<HANDLE, FileSearchHandleDeleter>;
+
+constexpr uint64_t GetFileSize(const WIN32_FIND_DATA& data) {
+  constexpr auto m = std::numeric_limits<decltype(data.nFileSizeLow)>::max();
+  return (data.nFileSizeHigh * (m + 1ull)) + data.nFileSizeLow;
+}
+
+static time_t GetUnixTime(const FILETIME& file_time) {
+  // FILETIME is the number of 100-nanosecond intervals since 1601-01-01
+  constexpr uint64_t kIntervalsPerSecond = 10000000;
+  constexpr uint64_t kUnixEpoch = 116444736000000000;
+  const auto intervals =
+      (static_cast<uint64_t>(file_time.dwHighDateTime) << 32) |
+      file_time.dwLowDateTime;
+  if (intervals < kUnixEpoch)
+    return 0;
+  return static_cast<time_t>((intervals - kUnixEpoch) / kIntervalsPerSecond);
+}
+
+bool ReadDirectory(const std::wstring& root, bool log_errors,
+                   const FileSearch::callback_function_t& on_entry) {
+  const auto path = AddTrailingSlash(GetExtendedLengthPath(root)) + L"*";
+
+  WIN32_FIND_DATA data;
+  FileSearchHandle handle(::FindFirstFile(path.c_str(), &data));
+
+  FileSearchResult result;
+  result.root = root;
+
+  do {
+    if (handle.get() == INVALID_HANDLE_VALUE) {
+      if (log_errors) {
+        auto error_message = win::FormatError(::GetLastError());
+        TrimRight(error_message, L"\r\n");
+        LOGE(L"{}\nPath: {}", error_message, path);
+      }
+      ::SetLastError(ERROR_SUCCESS);
+      continue;
+    }
+
+    if (IsSystemFile(data) || IsHiddenFile(data))
+      continue;
+    if (IsDirectory(data) && !IsValidDirectory(data))
+      continue;
+
+    result.name = data.cFileName;
+    result.size = GetFileSize(data);
+    result.last_write_time = GetUnixTime(data.ftLastWriteTime);
+    result.is_directory = IsDirectory(data);
+    result.is_read_only =
+        (data.dwFileAttributes & FILE_ATTRIBUTE_READONLY) != 0;
+
+    if (on_entry(result))
+      return true;
+
+  } while (::FindNextFile(handle.get(), &data));
+
+  return false;
+}
+
+std::wstring GetSubdirectoryPath(const std::wstring& root,
+                                 const std::wstring& name) {
+  return AddTrailingSlash(root) + name;
+}
+
+}  // namespace base::detail
@@ -0,0 +1,90 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace base {
+
+// A map that holds a limited number of items, evicting the least recently
+// used one when it's full. It is not thread-safe; callers that share a cache
+// between threads must guard it with a lock, including calls to Find.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+  explicit LruCache(size_t capacity) : capacity_{capacity} {}
+
+  // Returns nullptr if the key is not found. The pointer remains valid until
+  // the next call to a non-const function.
+  const Value* Find(const Key& key) {
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++misses_;
+      return nullptr;
+    }
+    ++hits_;
+    items_.splice(items_.begin(), items_, it->second);
+    return &it->second->second;
+  }
+
+  void Insert(const Key& key, Value value) {
+    if (!capacity_)
+      return;
+
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->second = std::move(value);
+      items_.splice(items_.begin(), items_, it->second);
+      return;
+    }
+
+    if (items_.size() >= capacity_) {
+      index_.erase(items_.back().first);
+      items_.pop_back();
+    }
+
+    items_.emplace_front(key, std::move(value));
+    index_.emplace(key, items_.begin());
+  }
+
+  void Clear() {
+    index_.clear();
+    items_.clear();
+  }
+
+  size_t capacity() const { return capacity_; }
+  size_t size() const { return items_.size(); }
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+private:
+  using items_t = std::list<std::pair<Key, Value>>;
+
+  size_t capacity_ = 0;
+  items_t items_;
+  std::unordered_map<Key, typename items_t::iterator, Hash> index_;
+
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+}  // namespace base
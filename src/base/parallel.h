@@ -0,0 +1,169 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// A fixed set of worker threads that are created on first use and kept until
+// the pool is stopped, so that frequent calls don't pay for creating threads.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t thread_count = 0) : thread_count_{thread_count} {}
+  ~ThreadPool() { Stop(); }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Calls `function` for each index in [0, count), spreading the calls over
+  // the worker threads. The calling thread takes part in the work, and the
+  // function returns after all calls are complete. Calls from different
+  // threads take turns; `function` must not call back into the same pool.
+  template <typename Function>
+  void ParallelFor(size_t count, Function&& function) {
+    if (!count)
+      return;
+
+    std::lock_guard call_lock{call_mutex_};
+
+    std::function<void(size_t)> job{std::forward<Function>(function)};
+
+    bool parallel = false;
+    {
+      std::lock_guard lock{mutex_};
+      if (!stopped_ && count > 1) {
+        Start();
+        parallel = !threads_.empty();
+      }
+      if (parallel) {
+        job_ = &job;
+        job_count_ = count;
+        next_index_ = 0;
+        ++generation_;
+      }
+    }
+
+    if (!parallel) {
+      for (size_t i = 0; i < count; ++i) {
+        job(i);
+      }
+      return;
+    }
+
+    job_started_.notify_all();
+
+    Run(job, count);
+
+    std::unique_lock lock{mutex_};
+    job_finished_.wait(lock, [this]() { return !active_workers_; });
+    job_ = nullptr;
+  }
+
+  // Joins the worker threads. Later calls run on the calling thread alone.
+  void Stop() {
+    std::lock_guard call_lock{call_mutex_};
+
+    {
+      std::lock_guard lock{mutex_};
+      stopped_ = true;
+    }
+    job_started_.notify_all();
+
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+private:
+  // Must be called while holding the lock
+  void Start() {
+    if (!threads_.empty())
+      return;
+
+    size_t thread_count = thread_count_;
+    if (!thread_count)
+      thread_count = std::thread::hardware_concurrency();
+
+    // The calling thread makes up for the last one
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads_.emplace_back(&ThreadPool::Work, this);
+    }
+  }
+
+  void Run(const std::function<void(size_t)>& job, size_t count) {
+    for (size_t i = next_index_++; i < count; i = next_index_++) {
+      job(i);
+    }
+  }
+
+  void Work() {
+    size_t generation = 0;
+
+    std::unique_lock lock{mutex_};
+
+    while (true) {
+      job_started_.wait(lock, [this, &generation]() {
+        return stopped_ || generation != generation_;
+      });
+      if (stopped_)
+        return;
+      generation = generation_;
+
+      // The job may have been finished by the other threads already
+      if (!job_)
+        continue;
+
+      const auto job = job_;
+      const auto count = job_count_;
+      ++active_workers_;
+      lock.unlock();
+
+      Run(*job, count);
+
+      lock.lock();
+      if (!--active_workers_)
+        job_finished_.notify_all();
+    }
+  }
+
+  size_t thread_count_ = 0;
+  std::vector<std::thread> threads_;
+
+  std::mutex call_mutex_;
+
+  std::mutex mutex_;
+  std::condition_variable job_started_;
+  std::condition_variable job_finished_;
+  const std::function<void(size_t)>* job_ = nullptr;
+  size_t job_count_ = 0;
+  size_t generation_ = 0;
+  size_t active_workers_ = 0;
+  bool stopped_ = false;
+
+  std::atomic_size_t next_index_ = 0;
+};
+
+}  // namespace base
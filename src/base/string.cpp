@@ -17,6 +17,7 @@
 */
 
 #include <algorithm>
+#include <array>
 #include <iomanip>
 #include <locale>
 #include <sstream>
@@ -206,29 +207,153 @@ bool EndsWith(const wstring& str1, const wstring& str2) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+// The functions below use bit-parallel algorithms, where each bit of a 64-bit
+// word represents a position in one of the strings. Strings that are longer
+// than 64 characters are handled in blocks of words.
+constexpr size_t kBlockSize = 64;
+
+int PopCount(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555);
+  x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0F;
+  return static_cast<int>((x * 0x0101010101010101) >> 56);
+}
+
+int CountTrailingZeros(const uint64_t x) {
+  static constexpr int table[64] = {
+     0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6,
+  };
+  return table[((x & (~x + 1)) * 0x03F79D71B4CB0A89) >> 58];
+}
+
+// Bit masks of the positions of each character in a pattern. The masks of
+// the last pattern are kept, as the same string is usually compared against
+// many others (e.g. a query against all candidate titles).
+class PatternMasks {
+public:
+  void Build(const wstring& pattern) {
+    if (pattern.size() == pattern_.size() && pattern == pattern_)
+      return;
+
+    for (const auto c : pattern_) {
+      if (static_cast<size_t>(c) < kTableSize)
+        std::fill_n(table_.begin() + c * blocks_, blocks_, 0);
+    }
+    other_chars_.clear();
+    other_masks_.clear();
+
+    pattern_ = pattern;
+    blocks_ = (pattern.size() + kBlockSize - 1) / kBlockSize;
+    table_.resize(kTableSize * blocks_);
+    empty_.resize(blocks_);
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      const auto c = pattern[i];
+      uint64_t* masks = nullptr;
+      if (static_cast<size_t>(c) < kTableSize) {
+        masks = &table_[c * blocks_];
+      } else {
+        const auto it = std::find(other_chars_.begin(), other_chars_.end(), c);
+        const size_t index = it - other_chars_.begin();
+        if (it == other_chars_.end()) {
+          other_chars_.push_back(c);
+          other_masks_.resize(other_masks_.size() + blocks_);
+        }
+        masks = &other_masks_[index * blocks_];
+      }
+      masks[i / kBlockSize] |= uint64_t{1} << (i % kBlockSize);
+    }
+  }
+
+  const uint64_t* Get(const wchar_t c) const {
+    if (static_cast<size_t>(c) < kTableSize)
+      return &table_[c * blocks_];
+    for (size_t i = 0; i < other_chars_.size(); ++i) {
+      if (other_chars_[i] == c)
+        return &other_masks_[i * blocks_];
+    }
+    return empty_.data();
+  }
+
+  size_t blocks() const { return blocks_; }
+
+private:
+  static constexpr size_t kTableSize = 0x100;
+
+  wstring pattern_;
+  size_t blocks_ = 0;
+  vector<uint64_t> table_;
+  vector<wchar_t> other_chars_;
+  vector<uint64_t> other_masks_;
+  vector<uint64_t> empty_;
+};
+
+// Returns the strings in the order that keeps the pattern within a single
+// word if possible. The second string is preferred as the pattern, as that is
+// the one that stays the same between calls when scoring titles.
+std::pair<const wstring&, const wstring&> SelectPattern(const wstring& str1,
+                                                        const wstring& str2) {
+  if (str2.size() > kBlockSize && str1.size() <= kBlockSize)
+    return {str2, str1};
+  return {str1, str2};
+}
+
+}  // namespace
+
+// Based on the bit-vector algorithm of Allison-Dix and Hyyro, where each
+// unset bit marks a position of the pattern at which the length of the common
+// subsequence increases.
 size_t LongestCommonSubsequenceLength(const wstring& str1,
                                       const wstring& str2) {
   if (str1.empty() || str2.empty())
     return 0;
 
-  const size_t len1 = str1.length();
-  const size_t len2 = str2.length();
+  const auto [text, pattern] = SelectPattern(str1, str2);
 
-  vector<vector<size_t>> table(len1 + 1);
-  for (auto it = table.begin(); it != table.end(); ++it)
-    it->resize(len2 + 1);
+  thread_local PatternMasks masks;
+  masks.Build(pattern);
+  const size_t blocks = masks.blocks();
 
-  for (size_t i = 0; i < len1; i++) {
-    for (size_t j = 0; j < len2; j++) {
-      if (str1[i] == str2[j]) {
-        table[i + 1][j + 1] = table[i][j] + 1;
-      } else {
-        table[i + 1][j + 1] = std::max(table[i + 1][j], table[i][j + 1]);
+  size_t length = 0;
+
+  if (blocks == 1) {
+    uint64_t v = ~uint64_t{0};
+    for (const auto c : text) {
+      const uint64_t u = v & *masks.Get(c);
+      v = (v + u) | (v - u);
+    }
+    const uint64_t mask = pattern.size() < kBlockSize ?
+        (uint64_t{1} << pattern.size()) - 1 : ~uint64_t{0};
+    length = PopCount(~v & mask);
+
+  } else {
+    thread_local vector<uint64_t> v;
+    v.assign(blocks, ~uint64_t{0});
+    for (const auto c : text) {
+      const uint64_t* m = masks.Get(c);
+      uint64_t carry = 0;
+      for (size_t b = 0; b < blocks; ++b) {
+        const uint64_t u = v[b] & m[b];
+        const uint64_t x = v[b] + carry;
+        const uint64_t sum = x + u;
+        carry = (x < carry) | (sum < u);
+        v[b] = sum | (v[b] - u);
       }
     }
+    for (size_t b = 0; b < blocks; ++b) {
+      const size_t bits = std::min(kBlockSize, pattern.size() - b * kBlockSize);
+      const uint64_t mask = bits < kBlockSize ?
+          (uint64_t{1} << bits) - 1 : ~uint64_t{0};
+      length += PopCount(~v[b] & mask);
+    }
   }
 
-  return table.back().back();
+  return length;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -244,35 +369,86 @@ double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
 
   int i, j, l;
   int m = 0, t = 0;
-  vector<int> sflags(len1), aflags(len2);
-
-  // Calculate matching characters
-  int range = std::max(0, (std::max(len1, len2) / 2) - 1);
-  for (i = 0; i < len2; i++) {
-    for (j = std::max(i - range, 0), l = std::min(i + range + 1, len1); j < l; j++) {
-      if (str2[i] == str1[j] && !sflags[j]) {
-        sflags[j] = 1;
+
+  const int range = std::max(0, (std::max(len1, len2) / 2) - 1);
+
+  // Characters are matched in the order of their positions in both strings,
+  // so the result doesn't depend on which string is scanned. The flags of the
+  // pattern are kept in a bit mask.
+  const auto [text, pattern] = SelectPattern(str1, str2);
+
+  if (pattern.size() <= kBlockSize) {
+    thread_local PatternMasks masks;
+    masks.Build(pattern);
+
+    const int pattern_length = static_cast<int>(pattern.size());
+    const int text_length = static_cast<int>(text.size());
+
+    uint64_t sflags = 0;
+    thread_local vector<int> aflags;
+    aflags.assign(text_length, 0);
+
+    // Calculate matching characters
+    for (i = 0; i < text_length; i++) {
+      const int first = std::max(i - range, 0);
+      const int last = std::min(i + range + 1, pattern_length);
+      if (first >= last)
+        continue;
+      const uint64_t window =
+          ((last - first < static_cast<int>(kBlockSize) ?
+            (uint64_t{1} << (last - first)) - 1 : ~uint64_t{0})) << first;
+      const uint64_t matches = *masks.Get(text[i]) & ~sflags & window;
+      if (matches) {
+        sflags |= matches & (~matches + 1);
         aflags[i] = 1;
         m++;
-        break;
       }
     }
-  }
-  if (!m)
-    return 0.0;
+    if (!m)
+      return 0.0;
+
+    // Calculate character transpositions
+    for (i = 0; i < text_length; i++) {
+      if (aflags[i] == 1) {
+        j = CountTrailingZeros(sflags);
+        sflags &= sflags - 1;
+        if (text[i] != pattern[j])
+          t++;
+      }
+    }
 
-  // Calculate character transpositions
-  l = 0;
-  for (i = 0; i < len2; i++) {
-    if (aflags[i] == 1) {
-      for (j = l; j < len1; j++) {
-        if (sflags[j] == 1) {
-          l = j + 1;
+  } else {
+    thread_local vector<int> sflags, aflags;
+    sflags.assign(len1, 0);
+    aflags.assign(len2, 0);
+
+    // Calculate matching characters
+    for (i = 0; i < len2; i++) {
+      for (j = std::max(i - range, 0), l = std::min(i + range + 1, len1); j < l; j++) {
+        if (str2[i] == str1[j] && !sflags[j]) {
+          sflags[j] = 1;
+          aflags[i] = 1;
+          m++;
           break;
         }
       }
-      if (str2[i] != str1[j])
-        t++;
+    }
+    if (!m)
+      return 0.0;
+
+    // Calculate character transpositions
+    l = 0;
+    for (i = 0; i < len2; i++) {
+      if (aflags[i] == 1) {
+        for (j = l; j < len1; j++) {
+          if (sflags[j] == 1) {
+            l = j + 1;
+            break;
+          }
+        }
+        if (str2[i] != str1[j])
+          t++;
+      }
     }
   }
   t /= 2;
@@ -295,64 +471,134 @@ double JaroWinklerDistance(const wstring& str1, const wstring& str2) {
   return dw;
 }
 
-double LevenshteinDistance(const wstring& str1, const wstring& str2) {
-  const size_t len1 = str1.size();
-  const size_t len2 = str2.size();
-
-  vector<size_t> prev_col(len2 + 1);
-  for (size_t i = 0; i < prev_col.size(); i++)
-    prev_col[i] = i;
-
-  vector<size_t> col(len2 + 1);
+// Based on Myers' bit-vector algorithm, as formulated by Hyyro for the edit
+// distance of whole strings. Vertical deltas of a column of the dynamic
+// programming table are kept in two bit vectors (+1 and -1), and the distance
+// is tracked at the last row.
+static size_t EditDistance(const wstring& str1, const wstring& str2) {
+  const auto [text, pattern] = SelectPattern(str1, str2);
+
+  if (pattern.empty())
+    return text.size();
+
+  thread_local PatternMasks masks;
+  masks.Build(pattern);
+  const size_t blocks = masks.blocks();
+
+  ptrdiff_t distance = pattern.size();
+
+  if (blocks == 1) {
+    const uint64_t last = uint64_t{1} << (pattern.size() - 1);
+    uint64_t pv = ~uint64_t{0};
+    uint64_t mv = 0;
+    for (const auto c : text) {
+      const uint64_t eq = *masks.Get(c);
+      const uint64_t xv = eq | mv;
+      const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+      uint64_t ph = mv | ~(xh | pv);
+      uint64_t mh = pv & xh;
+      distance += (ph & last) != 0;
+      distance -= (mh & last) != 0;
+      ph = (ph << 1) | 1;
+      mh <<= 1;
+      pv = mh | ~(xv | ph);
+      mv = ph & xv;
+    }
 
-  for (size_t i = 0; i < len1; i++) {
-    col[0] = i + 1;
+  } else {
+    // Myers' block-based variant, where the horizontal delta at the last row
+    // of each block is carried over to the next one
+    const uint64_t last =
+        uint64_t{1} << ((pattern.size() - 1) % kBlockSize);
+    thread_local vector<uint64_t> pv, mv;
+    pv.assign(blocks, ~uint64_t{0});
+    mv.assign(blocks, 0);
+    for (const auto c : text) {
+      const uint64_t* m = masks.Get(c);
+      int carry = 1;
+      for (size_t b = 0; b < blocks; ++b) {
+        const uint64_t high = b + 1 < blocks ? uint64_t{1} << 63 : last;
+        uint64_t eq = m[b];
+        const uint64_t xv = eq | mv[b];
+        if (carry < 0)
+          eq |= 1;
+        const uint64_t xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+        uint64_t ph = mv[b] | ~(xh | pv[b]);
+        uint64_t mh = pv[b] & xh;
+        const int carry_in = carry;
+        carry = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+        ph <<= 1;
+        mh <<= 1;
+        if (carry_in < 0)
+          mh |= 1;
+        else if (carry_in > 0)
+          ph |= 1;
+        pv[b] = mh | ~(xv | ph);
+        mv[b] = ph & xv;
+      }
+      distance += carry;
+    }
+  }
 
-    for (size_t j = 0; j < len2; j++)
-      col[j + 1] = std::min(std::min(1 + col[j], 1 + prev_col[1 + j]),
-                            prev_col[j] + (str1[i] == str2[j] ? 0 : 1));
+  return static_cast<size_t>(distance);
+}
 
-    col.swap(prev_col);
-  }
+double LevenshteinDistance(const wstring& str1, const wstring& str2) {
+  const auto distance = EditDistance(str1, str2);
 
   const double len = static_cast<double>(std::max(str1.size(), str2.size()));
-  return 1.0 - (prev_col[len2] / len);
+  return 1.0 - (distance / len);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void GetTrigrams(const wstring& str, trigram_container_t& output) {
-  const size_t n = 3;
-
-  if (n < 1)
-    return;
+trigram_t PackTrigram(const wchar_t c1, const wchar_t c2, const wchar_t c3) {
+  const auto pack = [](const wchar_t c) {
+    return static_cast<trigram_t>(c) & 0x1FFFFF;
+  };
+  return (pack(c1) << 42) | (pack(c2) << 21) | pack(c3);
+}
 
+void GetTrigrams(const wstring& str, trigram_container_t& output) {
   output.clear();
 
-  if (n >= str.size()) {
-    trigram_t buffer = {'\0'};
-    std::copy(str.begin(), str.end(), buffer.begin());
-    output.push_back(buffer);
+  if (str.size() <= 3) {
+    output.push_back(PackTrigram(str.size() > 0 ? str[0] : L'\0',
+                                 str.size() > 1 ? str[1] : L'\0',
+                                 str.size() > 2 ? str[2] : L'\0'));
     return;
   }
 
-  for (size_t i = 0; i <= str.size() - n; ++i) {
-    trigram_t buffer = {'\0'};
-    std::copy(str.begin() + i, str.begin() + (i + n), buffer.begin());
-    output.push_back(buffer);
+  output.reserve(str.size() - 2);
+  for (size_t i = 0; i + 3 <= str.size(); ++i) {
+    output.push_back(PackTrigram(str[i], str[i + 1], str[i + 2]));
   }
 
   std::sort(output.begin(), output.end());
 }
 
-double CompareTrigrams(const trigram_container_t& t1,
-                       const trigram_container_t& t2) {
-  trigram_container_t intersection;
+size_t CountCommonTrigrams(const trigram_container_t& t1,
+                           const trigram_container_t& t2) {
+  // Same as the size of the output of std::set_intersection, without the
+  // output and the branches that are hard to predict
+  size_t count = 0;
+  size_t i = 0;
+  size_t j = 0;
+
+  while (i < t1.size() && j < t2.size()) {
+    const auto a = t1[i];
+    const auto b = t2[j];
+    count += a == b;
+    i += a <= b;
+    j += b <= a;
+  }
 
-  std::set_intersection(t1.begin(), t1.end(), t2.begin(), t2.end(),
-                        std::back_inserter(intersection));
+  return count;
+}
 
-  return static_cast<double>(intersection.size()) /
+double CompareTrigrams(const trigram_container_t& t1,
+                       const trigram_container_t& t2) {
+  return static_cast<double>(CountCommonTrigrams(t1, t2)) /
          static_cast<double>(std::max(t1.size(), t2.size()));
 }
 
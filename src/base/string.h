@@ -18,7 +18,7 @@
 
 #pragma once
 
-#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <windows.h>
@@ -51,9 +51,13 @@ size_t LongestCommonSubsequenceLength(const std::wstring& str1, const std::wstri
 double JaroWinklerDistance(const std::wstring& str1, const std::wstring& str2);
 double LevenshteinDistance(const std::wstring& str1, const std::wstring& str2);
 
-using trigram_t = std::array<wchar_t, 3>;
+// Three 21-bit code units packed in an integer, so that trigrams sort in the
+// same order as their characters and compare in a single instruction
+using trigram_t = uint64_t;
 using trigram_container_t = std::vector<trigram_t>;
+trigram_t PackTrigram(const wchar_t c1, const wchar_t c2, const wchar_t c3);
 void GetTrigrams(const std::wstring& str, trigram_container_t& output);
+size_t CountCommonTrigrams(const trigram_container_t& t1, const trigram_container_t& t2);
 double CompareTrigrams(const trigram_container_t& t1, const trigram_container_t& t2);
 
 void ReplaceChar(std::wstring& str, const wchar_t c, const wchar_t replace_with);
@@ -30,6 +30,7 @@
 #include "media/library/history.h"
 #include "taiga/announce.h"
 #include "taiga/config.h"
+#include "taiga/debug.h"
 #include "taiga/dummy.h"
 #include "taiga/http.h"
 #include "taiga/resource.h"
@@ -37,6 +38,8 @@
 #include "taiga/version.h"
 #include "track/feed_aggregator.h"
 #include "track/media.h"
+#include "track/recognition.h"
+#include "track/scan_service.h"
 #include "ui/dialog.h"
 #include "ui/menu.h"
 #include "ui/theme.h"
@@ -60,6 +63,9 @@ CommandLineOptions ParseCommandLine() {
     } else if (arg == L"debug") {
       options.debug_mode = true;
       found = true;
+    } else if (arg == L"testrecognition") {
+      options.test_recognition = true;
+      found = true;
     } else if (arg == L"verbose") {
       options.verbose = true;
       found = true;
@@ -91,6 +97,8 @@ void LoadData() {
 
   library::history.Load();
   track::aggregator.archive.Load();
+
+  Meow.PrepareTitles();
 }
 
 }  // namespace detail
@@ -132,6 +140,12 @@ BOOL App::InitInstance() {
   // Load data
   detail::LoadData();
 
+  // Run recognition tests without the user interface
+  if (options.test_recognition) {
+    debug::TestRecognition();
+    return FALSE;
+  }
+
   InitializeDummies();
 
   // Initialize Discord
@@ -157,6 +171,8 @@ void App::Uninitialize() {
   announcer.Clear(kAnnounceToDiscord);
 
   // Cleanup
+  track::scan_service.Shutdown();
+  Meow.Shutdown();
   http::Shutdown();
   ui::taskbar.Destroy();
   ui::taskbar_list.Release();
@@ -27,6 +27,7 @@ namespace detail {
 struct CommandLineOptions {
   bool allow_multiple_instances = false;
   bool debug_mode = false;
+  bool test_recognition = false;
   bool verbose = false;
 };
 
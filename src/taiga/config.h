@@ -49,3 +49,6 @@
 
 // Store data at the same directory as the executable
 #define TAIGA_PORTABLE
+
+// Count calls to the recognition engine, and measure the time they take
+#define TAIGA_RECOGNITION_COUNTERS
@@ -16,12 +16,28 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <vector>
+
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
 
 #include "taiga/debug.h"
 
+#include "base/file.h"
 #include "base/format.h"
+#include "base/json.h"
 #include "base/log.h"
+#include "base/string.h"
+#include "base/xml.h"
+#include "media/anime.h"
+#include "taiga/path.h"
+#include "track/episode.h"
+#include "track/recognition.h"
+#include "track/recognition_counters.h"
 #include "ui/dlg/dlg_main.h"
 
 namespace taiga::debug {
@@ -47,7 +63,22 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static void LogRecognitionCounters() {
+  using namespace track::recognition;
+
+  for (size_t i = 0; i < kCounterCount; ++i) {
+    const auto counter = static_cast<Counter>(i);
+    const auto values = counters.Get(counter);
+    LOGD(L"{}: {} calls, {} hits, {:.2f}ms", GetCounterName(counter),
+         values.calls, values.hits, values.nanoseconds / 1e6);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void Test() {
+  LogRecognitionCounters();
+
   std::wstring str;
 
   Tester tester;
@@ -64,4 +95,211 @@ void Test() {
   tester.Stop(str);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Allocations can only be counted with the debug heap, which lets us hook
+// into every allocation without replacing the global operator new.
+#ifdef _DEBUG
+static std::atomic<size_t> allocation_count{0};
+
+static int CountAllocations(int type, void*, size_t, int, long,
+                            const unsigned char*, int) {
+  if (type == _HOOK_ALLOC || type == _HOOK_REALLOC)
+    ++allocation_count;
+  return TRUE;
+}
+#endif
+
+struct RecognitionTest {
+  std::wstring text;
+  int expected_id = anime::ID_UNKNOWN;
+  bool parse_path = false;
+};
+
+// The corpus is in the following format, where an ID of 0 means that the text
+// is not expected to be identified:
+//
+//   <recognition>
+//     <test id="1234">[Group] Title - 01 [720p].mkv</test>
+//     <test id="1234" path="true">D:\Anime\Title\01.mkv</test>
+//   </recognition>
+static bool ReadRecognitionTests(std::vector<RecognitionTest>& tests) {
+  XmlDocument document;
+  const auto path = taiga::GetPath(taiga::Path::TestRecognition);
+  const auto parse_result = XmlLoadFileToDocument(document, path);
+
+  if (!parse_result) {
+    LOGW(L"Could not read recognition tests: {}", path);
+    return false;
+  }
+
+  for (const auto node : document.child(L"recognition").children(L"test")) {
+    RecognitionTest test;
+    test.text = node.child_value();
+    test.expected_id = node.attribute(L"id").as_int();
+    test.parse_path = node.attribute(L"path").as_bool();
+    tests.push_back(std::move(test));
+  }
+
+  return !tests.empty();
+}
+
+static track::recognition::MatchOptions GetTestMatchOptions() {
+  track::recognition::MatchOptions match_options;
+  match_options.allow_sequels = true;
+  match_options.check_airing_date = true;
+  match_options.check_anime_type = true;
+  match_options.check_episode_number = true;
+  match_options.streaming_media = false;
+  return match_options;
+}
+
+bool TestRecognition() {
+  using clock_t = std::chrono::steady_clock;
+  using microseconds_t =
+      std::chrono::duration<double, std::chrono::microseconds::period>;
+
+  std::vector<RecognitionTest> tests;
+  if (!ReadRecognitionTests(tests))
+    return false;
+
+  Meow.InitializeTitles();
+
+  const auto match_options = GetTestMatchOptions();
+
+  Json json = {
+    {"count", tests.size()},
+    {"failures", Json::array()},
+  };
+
+  // Single-threaded, where each test is measured on its own. Caches are
+  // cleared so that the results do not depend on a previous run.
+  {
+    Meow.ClearCache();
+    track::recognition::counters.Reset();
+
+    std::vector<double> latencies;
+    latencies.reserve(tests.size());
+    size_t passed = 0;
+
+#ifdef _DEBUG
+    allocation_count = 0;
+    const auto previous_hook = _CrtSetAllocHook(CountAllocations);
+#endif
+
+    const auto t0 = clock_t::now();
+
+    for (const auto& test : tests) {
+      const auto t = clock_t::now();
+
+      track::recognition::ParseOptions parse_options;
+      parse_options.parse_path = test.parse_path;
+      anime::Episode episode;
+      track::recognition::Result result;
+      if (Meow.Parse(test.text, parse_options, episode))
+        Meow.Identify(episode, false, match_options, result);
+
+      latencies.push_back(microseconds_t{clock_t::now() - t}.count());
+
+      const int anime_id = std::max(episode.anime_id, 0);
+      if (anime_id == test.expected_id) {
+        ++passed;
+      } else {
+        json["failures"].push_back({
+          {"text", WstrToStr(test.text)},
+          {"expected", test.expected_id},
+          {"actual", anime_id},
+        });
+      }
+    }
+
+    const auto total = microseconds_t{clock_t::now() - t0}.count();
+
+#ifdef _DEBUG
+    _CrtSetAllocHook(previous_hook);
+#endif
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double p) {
+      const auto i = static_cast<size_t>(p * latencies.size());
+      return latencies[std::min(i, latencies.size() - 1)];
+    };
+
+    json["accuracy"] = static_cast<double>(passed) / tests.size();
+    json["single_threaded"] = {
+      {"total_ms", total / 1000},
+      {"p50_us", percentile(0.5)},
+      {"p99_us", percentile(0.99)},
+#ifdef _DEBUG
+      {"allocations_per_title",
+       static_cast<double>(allocation_count) / tests.size()},
+#else
+      {"allocations_per_title", nullptr},
+#endif
+    };
+
+    auto& json_counters = json["single_threaded"]["counters"];
+    for (size_t i = 0; i < track::recognition::kCounterCount; ++i) {
+      const auto counter = static_cast<track::recognition::Counter>(i);
+      const auto values = track::recognition::counters.Get(counter);
+      json_counters[WstrToStr(std::wstring{GetCounterName(counter)})] = {
+        {"calls", values.calls},
+        {"hits", values.hits},
+        {"total_ms", values.nanoseconds / 1e6},
+      };
+    }
+  }
+
+  // Multi-threaded, where tests are identified in batches. Results must be
+  // the same as above.
+  {
+    Meow.ClearCache();
+
+    size_t passed = 0;
+    const auto t0 = clock_t::now();
+
+    for (const bool parse_path : {false, true}) {
+      std::vector<std::wstring> texts;
+      std::vector<int> expected_ids;
+      for (const auto& test : tests) {
+        if (test.parse_path == parse_path) {
+          texts.push_back(test.text);
+          expected_ids.push_back(test.expected_id);
+        }
+      }
+
+      track::recognition::ParseOptions parse_options;
+      parse_options.parse_path = parse_path;
+      std::vector<anime::Episode> episodes;
+      Meow.IdentifyBatch(texts, parse_options, match_options, episodes);
+
+      for (size_t i = 0; i < episodes.size(); ++i) {
+        if (std::max(episodes[i].anime_id, 0) == expected_ids[i])
+          ++passed;
+      }
+    }
+
+    const auto total = microseconds_t{clock_t::now() - t0}.count();
+
+    json["multi_threaded"] = {
+      {"total_ms", total / 1000},
+      {"titles_per_second", tests.size() / (total / 1000000)},
+      {"accuracy", static_cast<double>(passed) / tests.size()},
+    };
+  }
+
+  const auto path = taiga::GetPath(taiga::Path::TestRecognitionResults);
+  if (!SaveToFile(json.dump(2), path)) {
+    LOGW(L"Could not save recognition test results: {}", path);
+    return false;
+  }
+
+  LOGD(L"Accuracy: {:.4f}, p50: {:.1f}us, p99: {:.1f}us",
+       json["accuracy"].get<double>(),
+       json["single_threaded"]["p50_us"].get<double>(),
+       json["single_threaded"]["p99_us"].get<double>());
+
+  return true;
+}
+
 }  // namespace taiga::debug
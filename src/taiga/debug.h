@@ -22,4 +22,9 @@ namespace taiga::debug {
 
 void Test();
 
+// Replays the recognition corpus at Path::TestRecognition, and writes the
+// accuracy, latency and allocation count of the engine to
+// Path::TestRecognitionResults as JSON.
+bool TestRecognition();
+
 }  // namespace taiga::debug
@@ -64,10 +64,14 @@ std::wstring GetPath(Path path) {
       return data_path + L"db\\";
     case Path::DatabaseAnime:
       return data_path + L"db\\anime.xml";
+    case Path::DatabaseAnimeIndex:
+      return data_path + L"db\\anime-index.bin";
     case Path::DatabaseAnimeRelations:
       return data_path + L"db\\anime-relations.txt";
     case Path::DatabaseImage:
       return data_path + L"db\\image\\";
+    case Path::DatabaseScanIndex:
+      return data_path + L"db\\scan-index.bin";
     case Path::Feed:
       return data_path + L"feed\\";
     case Path::FeedHistory:
@@ -80,6 +84,8 @@ std::wstring GetPath(Path path) {
       return data_path + L"test\\";
     case Path::TestRecognition:
       return data_path + L"test\\recognition.xml";
+    case Path::TestRecognitionResults:
+      return data_path + L"test\\recognition.json";
     case Path::Theme:
       return data_path + L"theme\\";
     case Path::ThemeCurrent:
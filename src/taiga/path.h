@@ -30,14 +30,17 @@ enum class Path {
   Data,
   Database,
   DatabaseAnime,
+  DatabaseAnimeIndex,
   DatabaseAnimeRelations,
   DatabaseImage,
+  DatabaseScanIndex,
   Feed,
   FeedHistory,
   Media,
   Settings,
   Test,
   TestRecognition,
+  TestRecognitionResults,
   Theme,
   ThemeCurrent,
   User,
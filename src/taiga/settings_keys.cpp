@@ -36,6 +36,7 @@
 #include "taiga/settings.h"
 #include "track/feed_aggregator.h"
 #include "track/monitor.h"
+#include "track/recognition.h"
 #include "ui/dlg/dlg_anime_list.h"
 #include "ui/dlg/dlg_season.h"
 #include "ui/list.h"
@@ -733,7 +734,9 @@ std::wstring Settings::GetRecognitionIgnoredStrings() const {
 }
 
 void Settings::SetRecognitionIgnoredStrings(const std::wstring& str) {
-  set_value(AppSettingKey::RecognitionIgnoredStrings, str);
+  if (set_value(AppSettingKey::RecognitionIgnoredStrings, str)) {
+    Meow.ClearCache();
+  }
 }
 
 bool Settings::GetRecognitionLookupParentDirectories() const {
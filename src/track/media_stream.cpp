@@ -16,8 +16,12 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <regex>
 #include <set>
+#include <string_view>
 
 #include "track/media_stream.h"
 
@@ -229,7 +233,32 @@ void EnableStream(const Stream stream, const bool enabled) {
   }
 }
 
-const StreamData* FindStreamFromUrl(std::wstring url) {
+// Literal strings that a URL must contain for the pattern of a stream to
+// match. These are checked before the patterns, which are much slower, so
+// that only the candidate streams of a URL are tried.
+static const std::vector<std::string_view>& GetStreamUrlKeywords(
+    const Stream stream) {
+  static const std::map<Stream, std::vector<std::string_view>> keywords{
+    {Stream::Animelab, {"animelab.com/player/"}},
+    {Stream::Adn, {"animedigitalnetwork"}},
+    {Stream::Ann, {"animenewsnetwork."}},
+    {Stream::Crunchyroll, {"crunchyroll."}},
+    {Stream::Funimation, {"funimation.com/shows/"}},
+    {Stream::Hidive, {"hidive.com/stream/"}},
+    {Stream::Plex, {"plex", ":32400/web/"}},
+    {Stream::Veoh, {"veoh.com/watch/"}},
+    {Stream::Viz, {"viz.com/watch/streaming/"}},
+    {Stream::Vrv, {"vrv.co/watch/"}},
+    {Stream::Wakanim, {"wakanim.tv/"}},
+    {Stream::Yahoo, {"yahoo"}},
+    {Stream::Youtube, {"youtube.com/watch"}},
+  };
+  return keywords.at(stream);
+}
+
+// Returns the first stream with a matching pattern, regardless of whether it
+// is enabled.
+static const StreamData* MatchStreamUrl(std::wstring url) {
   EraseLeft(url, L"http://");
   EraseLeft(url, L"https://");
 
@@ -239,9 +268,13 @@ const StreamData* FindStreamFromUrl(std::wstring url) {
   const std::string str = WstrToStr(url);
 
   for (const auto& item : stream_data) {
-    if (std::regex_search(str, item.url_pattern)) {;
-      return IsStreamEnabled(item.id) ? &item : nullptr;
-    }
+    const auto& keywords = GetStreamUrlKeywords(item.id);
+    const bool is_candidate = std::any_of(
+        keywords.begin(), keywords.end(), [&str](std::string_view keyword) {
+          return str.find(keyword) != str.npos;
+        });
+    if (is_candidate && std::regex_search(str, item.url_pattern))
+      return &item;
   }
 
   return nullptr;
@@ -317,12 +350,34 @@ void CleanStreamTitle(const StreamData& stream_data, std::string& title) {
 
 bool GetTitleFromStreamingMediaProvider(const std::wstring& url,
                                         std::wstring& title) {
-  const auto stream = FindStreamFromUrl(url);
+  // Browser state rarely changes between detection ticks, so the result of
+  // the last call is reused. Whether the stream is enabled is checked again,
+  // as it can change in the meantime.
+  struct LastResult {
+    std::wstring url;
+    std::wstring title;
+    const StreamData* stream = nullptr;
+    std::wstring stream_title;
+  };
+  static LastResult last_result;
+  static std::mutex last_result_mutex;
+
+  std::lock_guard lock{last_result_mutex};
+
+  if (url != last_result.url || title != last_result.title) {
+    last_result.url = url;
+    last_result.title = title;
+    last_result.stream = MatchStreamUrl(url);
+    last_result.stream_title.clear();
+    if (last_result.stream) {
+      std::string str = WstrToStr(title);
+      CleanStreamTitle(*last_result.stream, str);
+      last_result.stream_title = StrToWstr(str);
+    }
+  }
 
-  if (stream) {
-    std::string str = WstrToStr(title);
-    CleanStreamTitle(*stream, str);
-    title = StrToWstr(str);
+  if (last_result.stream && IsStreamEnabled(last_result.stream->id)) {
+    title = last_result.stream_title;
   } else {
     title.clear();
   }
@@ -64,9 +64,10 @@ bool PlayEpisode(const int anime_id, int number) {
 
   // Scan available episodes
   if (file_path.empty()) {
-    ScanAvailableEpisodes(false, anime_id, number);
-    if (anime_item->IsEpisodeAvailable(number)) {
-      file_path = track::scanner.path_found();
+    std::wstring path_found;
+    if (ScanAvailableEpisodesNow(anime_id, number, path_found) &&
+        anime_item->IsEpisodeAvailable(number)) {
+      file_path = path_found;
     }
   }
 
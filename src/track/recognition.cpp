@@ -16,6 +16,9 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <future>
+
 #include <anitomy/anitomy/anitomy.h>
 #include <anitomy/anitomy/keyword.h>
 
@@ -28,11 +31,14 @@
 #include "media/anime_util.h"
 #include "taiga/settings.h"
 #include "track/episode.h"
+#include "track/recognition_counters.h"
 
 namespace track::recognition {
 
 bool Engine::Parse(std::wstring filename, const ParseOptions& parse_options,
                    anime::Episode& episode) const {
+  RECOGNITION_COUNT(Parse);
+
   // Clear previous data
   episode.Clear();
 
@@ -47,33 +53,88 @@ bool Engine::Parse(std::wstring filename, const ParseOptions& parse_options,
   if (filename.empty())
     return false;
 
+  const auto parsed_filename = ParseFilename(filename, parse_options);
+
+  if (!parsed_filename->parsed) {
+    if (episode.folder.empty())  // If not, perhaps we can parse the path later on
+      return false;
+  }
+
+  episode.set_elements(parsed_filename->elements);
+
+  return true;
+}
+
+std::shared_ptr<const Engine::ParsedFilename> Engine::ParseFilename(
+    const std::wstring& filename, const ParseOptions& parse_options) const {
+  const auto ignored_strings = taiga::settings.GetRecognitionIgnoredStrings();
+
+  std::unique_lock lock{parse_cache_mutex_};
+
+  if (ignored_strings != ignored_strings_ || !ignored_strings_revision_) {
+    if (ignored_strings_revision_) {
+      LOGD(L"Ignored strings changed. Hits: {}, misses: {}, size: {}",
+           parse_cache_.hits(), parse_cache_.misses(), parse_cache_.size());
+    }
+    ignored_strings_ = ignored_strings;
+    ignored_string_list_.clear();
+    Split(ignored_strings_, L"|", ignored_string_list_);
+    ++ignored_strings_revision_;
+  }
+
+  ParseKey key{filename, parse_options.streaming_media,
+               ignored_strings_revision_};
+  if (const auto parsed_filename = parse_cache_.Find(key)) {
+    RECOGNITION_COUNT_HIT(Parse);
+    return *parsed_filename;
+  }
+
   anitomy::Anitomy anitomy_instance;
 
   // Set Anitomy options
   if (parse_options.streaming_media)
     anitomy_instance.options().allowed_delimiters = L" ";
-  Split(taiga::settings.GetRecognitionIgnoredStrings(), L"|",
-        anitomy_instance.options().ignored_strings);
+  anitomy_instance.options().ignored_strings = ignored_string_list_;
+
+  lock.unlock();
 
-  if (!anitomy_instance.Parse(filename)) {
+  auto parsed_filename = std::make_shared<ParsedFilename>();
+
+  parsed_filename->parsed = anitomy_instance.Parse(filename);
+  if (!parsed_filename->parsed)
     LOGD(L"Could not parse filename: {}", filename);
-    if (episode.folder.empty())  // If not, perhaps we can parse the path later on
-      return false;
-  }
 
+  // Anime title only depends on the elements, so it's extended before caching
+  anime::Episode episode;
   episode.set_elements(anitomy_instance.elements());
-
   ExtendAnimeTitle(episode);
+  parsed_filename->elements = std::move(episode.elements());
 
-  return true;
+  lock.lock();
+  parse_cache_.Insert(std::move(key), parsed_filename);
+  return parsed_filename;
 }
 
 int Engine::Identify(anime::Episode& episode, bool give_score,
                      const MatchOptions& match_options) {
-  std::set<int> anime_ids;
-
   InitializeTitles();
 
+  Result result;
+  const int anime_id = Identify(episode, give_score, match_options, result);
+
+  std::lock_guard lock{scores_mutex_};
+  scores_ = std::move(result.scores);
+
+  return anime_id;
+}
+
+int Engine::Identify(anime::Episode& episode, bool give_score,
+                     const MatchOptions& match_options, Result& result) const {
+  std::shared_lock lock{mutex_};
+
+  std::set<int> anime_ids;
+  result.scores.clear();
+
   auto valide_ids = [&](anime::Episode& episode) {
     for (auto it = anime_ids.begin(); it != anime_ids.end(); ) {
       if (!ValidateOptions(episode, *it, match_options, true)) {
@@ -86,14 +147,19 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
 
   auto look_up_merged_title = [&](
       const std::initializer_list<anitomy::ElementCategory>& elements) {
-    anime::Episode episode_merged_title(episode);
     auto merged_title = episode.anime_title();
     for (const auto& element : elements) {
       merged_title += L" " + episode.elements().get(element);
+    }
+    LookUpTitle(merged_title, anime_ids);
+    // The episode is copied only if there is something to validate
+    if (anime_ids.empty())
+      return;
+    anime::Episode episode_merged_title(episode);
+    for (const auto& element : elements) {
       episode_merged_title.elements().erase(element);
     }
     episode_merged_title.set_anime_title(merged_title);
-    LookUpTitle(episode_merged_title.anime_title(), anime_ids);
     valide_ids(episode_merged_title);
     if (!anime_ids.empty()) {
       std::swap(episode_merged_title, episode);
@@ -128,16 +194,21 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
   if (anime_ids.empty() && !episode.folder.empty() &&
       taiga::settings.GetRecognitionLookupParentDirectories() &&
       episode.anime_type().empty()) {
-    anime::Episode episode_from_directory(episode);
-    episode_from_directory.elements().erase(anitomy::kElementAnimeTitle);
-    if (GetTitleFromPath(episode_from_directory)) {
-      LookUpTitle(episode_from_directory.anime_title(), anime_ids);
-      valide_ids(episode_from_directory);
+    std::wstring directory_title;
+    if (GetTitleFromPath(episode, directory_title)) {
+      LookUpTitle(directory_title, anime_ids);
+      // The episode is copied only if there is something to validate
       if (!anime_ids.empty()) {
-        std::swap(episode_from_directory, episode);
-        LOGD(L"Parent directory lookup succeeded: {} -> {}",
-             episode_from_directory.anime_title(),
-             episode.anime_title());
+        anime::Episode episode_from_directory(episode);
+        episode_from_directory.elements().erase(anitomy::kElementAnimeTitle);
+        GetTitleFromPath(episode_from_directory);
+        valide_ids(episode_from_directory);
+        if (!anime_ids.empty()) {
+          std::swap(episode_from_directory, episode);
+          LOGD(L"Parent directory lookup succeeded: {} -> {}",
+               episode_from_directory.anime_title(),
+               episode.anime_title());
+        }
       }
     }
   }
@@ -153,9 +224,9 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
   } else if (anime_ids.size() == 1) {
     episode.anime_id = *anime_ids.begin();
   } else if (anime_ids.size() > 1) {
-    episode.anime_id = ScoreTitle(episode, anime_ids, match_options);
+    episode.anime_id = ScoreTitle(episode, anime_ids, match_options, result);
   } else if (anime_ids.empty() && give_score) {
-    ScoreTitle(episode, anime_ids, match_options);
+    ScoreTitle(episode, anime_ids, match_options, result);
   }
 
   // Post-processing
@@ -189,124 +260,321 @@ int Engine::Identify(anime::Episode& episode, bool give_score,
 }
 
 bool Engine::Search(const std::wstring& title, std::vector<int>& anime_ids) {
+  InitializeTitles();
+
+  Result result;
+  const bool found = Search(title, anime_ids, result);
+
+  std::lock_guard lock{scores_mutex_};
+  scores_ = std::move(result.scores);
+
+  return found;
+}
+
+bool Engine::Search(const std::wstring& title, std::vector<int>& anime_ids,
+                    Result& result) const {
+  std::shared_lock lock{mutex_};
+
   anime::Episode episode;
   episode.set_anime_title(title);
 
   std::set<int> empty_set;
   track::recognition::MatchOptions default_options;
 
-  InitializeTitles();
-
-  ScoreTitle(episode, empty_set, default_options);
+  result.scores.clear();
+  ScoreTitle(episode, empty_set, default_options, result);
 
-  for (const auto& score : scores_) {
+  for (const auto& score : result.scores) {
     anime_ids.push_back(score.first);
   }
 
   return !anime_ids.empty();
 }
 
+void Engine::IdentifyBatch(const std::vector<std::wstring>& filenames,
+                           const ParseOptions& parse_options,
+                           const MatchOptions& match_options,
+                           std::vector<anime::Episode>& episodes) {
+  InitializeTitles();
+
+  episodes.clear();
+  episodes.resize(filenames.size());
+
+  // Each call gets its own Anitomy instance and result, so the only shared
+  // state is the title index, which is read under a shared lock.
+  thread_pool_.ParallelFor(filenames.size(), [&](size_t i) {
+    auto& episode = episodes[i];
+    if (Parse(filenames[i], parse_options, episode)) {
+      Result result;
+      Identify(episode, false, match_options, result);
+    }
+  });
+
+  const auto stats = GetParseCacheStats();
+  LOGD(L"Parsed {} filenames. Hits: {}, misses: {}, size: {}",
+       filenames.size(), stats.hits, stats.misses, stats.size);
+}
+
+void Engine::IdentifyBatch(std::vector<anime::Episode>& episodes,
+                           const MatchOptions& match_options) {
+  InitializeTitles();
+
+  thread_pool_.ParallelFor(episodes.size(), [&](size_t i) {
+    Result result;
+    Identify(episodes[i], false, match_options, result);
+  });
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
+Engine::~Engine() {
+  // The thread should have been joined by Shutdown, as the globals that it
+  // uses may already be destroyed at this point
+  if (build_thread_.joinable())
+    build_thread_.join();
+}
+
+void Engine::Shutdown() {
+  if (build_thread_.joinable())
+    build_thread_.join();
+  thread_pool_.Stop();
+}
+
+void Engine::PrepareTitles() {
+  std::call_once(titles_initialized_, [this]() { LoadTitles(true); });
+}
+
 void Engine::InitializeTitles() {
-  static bool initialized = false;
+  std::call_once(titles_initialized_, [this]() { LoadTitles(false); });
+
+  // Wait for the index to be loaded, if it's being done in the background
+  const auto titles_ready = titles_ready_;
+  if (titles_ready.valid())
+    titles_ready.wait();
+}
+
+// Only the titles are collected on the calling thread, as the database is not
+// safe to read from elsewhere. Reading the snapshot, parsing relations and
+// rebuilding the index are all done by the build thread.
+void Engine::LoadTitles(bool background) {
+  std::vector<ItemTitles> items;
+  items.reserve(anime::db.items.size());
+  for (const auto& [anime_id, anime_item] : anime::db.items) {
+    items.push_back(GetItemTitles(anime_item));
+  }
+
+  std::promise<void> titles_ready;
+  titles_ready_ = titles_ready.get_future().share();
 
-  if (!initialized) {
-    initialized = true;
-    for (const auto& it : anime::db.items) {
-      UpdateTitles(it.second);
+  {
+    std::lock_guard lock{mutex_};
+    building_titles_ = true;
+  }
+
+  auto build = [this, items = std::move(items),
+                titles_ready = std::move(titles_ready)]() mutable {
+    const auto titles_stamp = GetTitlesStamp(items);
+    const auto relations_stamp = GetRelationsStamp();
+
+    indexed_titles_t indexed_titles;
+    bool relations_loaded = false;
+    const bool titles_loaded = ReadSnapshot(titles_stamp, relations_stamp,
+                                            indexed_titles, relations_loaded);
+
+    if (!relations_loaded)
+      ReadRelations();
+
+    if (!titles_loaded) {
+      indexed_titles.resize(items.size());
+      thread_pool_.ParallelFor(items.size(), [&](size_t i) {
+        indexed_titles[i].first = items[i].id;
+        IndexTitles(items[i], indexed_titles[i].second);
+      });
+    }
+
+    {
+      std::lock_guard lock{mutex_};
+      for (const auto& [anime_id, titles] : indexed_titles) {
+        AddTitles(anime_id, titles, true);
+      }
+      // Titles that were updated during the rebuild are more recent
+      for (const auto& [anime_id, titles] : pending_titles_) {
+        AddTitles(anime_id, titles, true);
+      }
+      pending_titles_.clear();
+      building_titles_ = false;
     }
 
-    ReadRelations();
+    titles_ready.set_value();
+
+    if (titles_loaded && relations_loaded)
+      return;
+
+    LOGD(L"Rebuilding the snapshot of {}.",
+         titles_loaded ? L"relations" : L"titles");
+
+    WriteSnapshot(titles_stamp, indexed_titles,
+                  relations_stamp, WriteRelationsSnapshot());
+  };
+
+  if (background) {
+    build_thread_ = std::thread(std::move(build));
+  } else {
+    build();
   }
 }
 
 void Engine::UpdateTitles(const anime::Item& anime_item, bool erase_ids) {
-  const int anime_id = anime_item.GetId();
+  std::vector<IndexedTitle> indexed_titles;
+  IndexTitles(GetItemTitles(anime_item), indexed_titles);
 
-  db_[anime_id].normal_titles.clear();
-  db_[anime_id].trigrams.clear();
+  std::lock_guard lock{mutex_};
 
-  if (erase_ids) {
-    auto erase_id = [&anime_id](Titles::container_t& titles) {
-      for (auto& title : titles) {
-        title.second.erase(anime_id);
-      }
-    };
-    erase_id(titles_.alternative);
-    erase_id(titles_.main);
-    erase_id(titles_.user);
-    erase_id(normal_titles_.alternative);
-    erase_id(normal_titles_.main);
-    erase_id(normal_titles_.user);
-  }
+  AddTitles(anime_item.GetId(), indexed_titles, erase_ids);
 
-  auto update_title = [&](std::wstring title,
-                          Titles::container_t& titles,
-                          Titles::container_t& normal_titles) {
-    if (!title.empty()) {
-      Normalize(title, kNormalizeForTrigrams, false);
-      trigram_container_t trigrams;
-      GetTrigrams(title, trigrams);
-      db_[anime_id].trigrams.push_back(trigrams);
-      db_[anime_id].normal_titles.push_back(title);
+  if (building_titles_)
+    pending_titles_.emplace_back(anime_item.GetId(), std::move(indexed_titles));
+}
 
-      Normalize(title, kNormalizeForLookup, true);
-      titles[title].insert(anime_id);
+Engine::ItemTitles Engine::GetItemTitles(const anime::Item& anime_item) {
+  ItemTitles item_titles;
+  item_titles.id = anime_item.GetId();
 
-      Normalize(title, kNormalizeFull, true);
-      normal_titles[title].insert(anime_id);
-    }
-  };
+  auto& titles = item_titles.titles;
 
-  update_title(anime_item.GetTitle(), titles_.main, normal_titles_.main);
-  update_title(anime_item.GetEnglishTitle(), titles_.main, normal_titles_.main);
-  update_title(anime_item.GetJapaneseTitle(), titles_.main, normal_titles_.main);
+  titles.emplace_back(kTitleMain, anime_item.GetTitle());
+  titles.emplace_back(kTitleMain, anime_item.GetEnglishTitle());
+  titles.emplace_back(kTitleMain, anime_item.GetJapaneseTitle());
 
   const auto& date = anime_item.GetDateStart();
   if (anime::IsValidDate(date)) {
     std::wstring year = ToWstr(date.year());
     if (anime_item.GetTitle().find(year) == std::wstring::npos) {
-      update_title(anime_item.GetTitle() + L" (" + year + L")",
-                   titles_.alternative, normal_titles_.alternative);
+      titles.emplace_back(kTitleAlternative,
+                          anime_item.GetTitle() + L" (" + year + L")");
     }
   }
 
   for (const auto& synonym : anime_item.GetSynonyms()) {
-    update_title(synonym, titles_.alternative, normal_titles_.alternative);
+    titles.emplace_back(kTitleAlternative, synonym);
   }
   for (const auto& synonym : anime_item.GetUserSynonyms()) {
-    update_title(synonym, titles_.user, normal_titles_.user);
+    titles.emplace_back(kTitleUser, synonym);
   }
+
+  return item_titles;
 }
 
-int Engine::LookUpTitle(std::wstring title, std::set<int>& anime_ids) const {
+void Engine::IndexTitles(const ItemTitles& item_titles,
+                         std::vector<IndexedTitle>& indexed_titles) const {
+  indexed_titles.clear();
+
+  for (const auto& [type, title] : item_titles.titles) {
+    if (title.empty())
+      continue;
+
+    IndexedTitle indexed_title;
+    indexed_title.type = type;
+
+    indexed_title.normal_title = title;
+    Normalize(indexed_title.normal_title, kNormalizeForTrigrams, false);
+    GetTrigrams(indexed_title.normal_title, indexed_title.trigrams);
+
+    indexed_title.lookup_title = indexed_title.normal_title;
+    Normalize(indexed_title.lookup_title, kNormalizeForLookup, true);
+
+    indexed_title.full_title = indexed_title.lookup_title;
+    Normalize(indexed_title.full_title, kNormalizeFull, true);
+
+    indexed_titles.push_back(std::move(indexed_title));
+  }
+}
+
+// Must be called while holding an exclusive lock
+void Engine::AddTitles(int anime_id,
+                       const std::vector<IndexedTitle>& indexed_titles,
+                       bool erase_ids) {
+  auto& score_store = db_[anime_id];
+
+  // Remove the ID from the posting lists of its previous trigrams
+  for (const auto& trigrams : score_store.trigrams) {
+    for (const auto& trigram : trigrams) {
+      auto it = trigram_index_.find(trigram);
+      if (it == trigram_index_.end())
+        continue;
+      auto& ids = it->second;
+      auto id_it = std::lower_bound(ids.begin(), ids.end(), anime_id);
+      if (id_it != ids.end() && *id_it == anime_id)
+        ids.erase(id_it);
+      if (ids.empty())
+        trigram_index_.erase(it);
+    }
+  }
+
+  score_store.normal_titles.clear();
+  score_store.trigrams.clear();
+
+  if (erase_ids) {
+    auto erase_id = [&anime_id](Titles::container_t& titles) {
+      titles.Erase(anime_id);
+    };
+    erase_id(titles_.alternative);
+    erase_id(titles_.main);
+    erase_id(titles_.user);
+    erase_id(normal_titles_.alternative);
+    erase_id(normal_titles_.main);
+    erase_id(normal_titles_.user);
+  }
+
+  for (const auto& indexed_title : indexed_titles) {
+    score_store.trigrams.push_back(indexed_title.trigrams);
+    score_store.normal_titles.push_back(indexed_title.normal_title);
+    titles_.get(indexed_title.type).Insert(indexed_title.lookup_title, anime_id);
+    normal_titles_.get(indexed_title.type).Insert(indexed_title.full_title, anime_id);
+  }
+
+  // Add the ID to the posting lists of its current trigrams, keeping each list
+  // sorted and free of duplicates
+  for (const auto& trigrams : score_store.trigrams) {
+    for (const auto& trigram : trigrams) {
+      auto& ids = trigram_index_[trigram];
+      auto id_it = std::lower_bound(ids.begin(), ids.end(), anime_id);
+      if (id_it == ids.end() || *id_it != anime_id)
+        ids.insert(id_it, anime_id);
+    }
+  }
+}
+
+int Engine::LookUpTitle(const std::wstring& title,
+                        std::set<int>& anime_ids) const {
+  RECOGNITION_COUNT(LookUpTitle);
+
   int anime_id = anime::ID_UNKNOWN;
 
   auto find_title = [&](const std::wstring& title,
                         const Titles::container_t& container) {
     if (!anime::IsValidId(anime_id)) {
-      auto it = container.find(title.c_str());
-      if (it != container.end()) {
-        anime_ids.insert(it->second.begin(), it->second.end());
+      const auto ids = container.Find(title.c_str());
+      if (ids) {
+        anime_ids.insert(ids->begin(), ids->end());
         if (anime_ids.size() == 1)
           anime_id = *anime_ids.begin();
       }
     }
   };
 
-  Normalize(title, kNormalizeForLookup, false);
-  find_title(title, titles_.user);
-  find_title(title, titles_.main);
-  find_title(title, titles_.alternative);
+  const auto normalized_title = GetNormalizedTitle(title);
+
+  find_title(normalized_title->lookup_title, titles_.user);
+  find_title(normalized_title->lookup_title, titles_.main);
+  find_title(normalized_title->lookup_title, titles_.alternative);
 
   if (anime_ids.size() == 1)
     return anime_id;
 
-  Normalize(title, kNormalizeFull, true);
-  find_title(title, normal_titles_.user);
-  find_title(title, normal_titles_.main);
-  find_title(title, normal_titles_.alternative);
+  find_title(normalized_title->full_title, normal_titles_.user);
+  find_title(normalized_title->full_title, normal_titles_.main);
+  find_title(normalized_title->full_title, normal_titles_.alternative);
 
   return anime_id;
 }
@@ -366,11 +634,81 @@ void Engine::ExtendAnimeTitle(anime::Episode& episode) const {
   }
 }
 
-bool Engine::GetTitleFromPath(anime::Episode& episode) {
+bool Engine::GetTitleFromPath(anime::Episode& episode) const {
   if (episode.folder.empty())
     return false;
 
-  std::wstring path = episode.folder;
+  RECOGNITION_COUNT(TitleFromPath);
+
+  const auto directory_title = FindDirectoryTitle(episode.folder);
+
+  if (directory_title.season && !episode.anime_season())
+    episode.set_anime_season(directory_title.season);
+
+  if (directory_title.title.empty())
+    return false;
+
+  episode.set_anime_title(directory_title.title);
+  if (!directory_title.year.empty())
+    episode.SetElementValue(anitomy::kElementAnimeYear, directory_title.year);
+
+  auto find_number_in_string = [](const std::wstring& str) {
+    auto it = std::find_if(str.begin(), str.end(), IsNumericChar);
+    return it == str.end() ? str.npos : (it - str.begin());
+  };
+
+  if (episode.elements().empty(anitomy::kElementEpisodeNumber)) {
+    const auto& filename = episode.file_name();
+    auto pos = find_number_in_string(filename);
+    if (pos == 0)  // begins with a number (e.g. "01.mkv", "02 - Title.mkv")
+      episode.set_episode_number(ToInt(filename.substr(pos)));
+  }
+
+  ExtendAnimeTitle(episode);
+
+  return true;
+}
+
+// Returns the title that the function above would give to a copy of the
+// episode without its anime title. Only the elements that the title depends
+// on are set, so the episode itself does not have to be copied.
+bool Engine::GetTitleFromPath(const anime::Episode& episode,
+                              std::wstring& title) const {
+  if (episode.folder.empty())
+    return false;
+
+  const auto directory_title = FindDirectoryTitle(episode.folder);
+
+  if (directory_title.title.empty())
+    return false;
+
+  anime::Episode title_episode;
+  title_episode.set_anime_title(directory_title.title);
+  if (const int season = episode.anime_season()) {
+    title_episode.set_anime_season(season);
+  } else if (directory_title.season) {
+    title_episode.set_anime_season(directory_title.season);
+  }
+  if (!directory_title.year.empty()) {
+    title_episode.SetElementValue(anitomy::kElementAnimeYear,
+                                  directory_title.year);
+  } else if (const int year = episode.anime_year()) {
+    title_episode.set_anime_year(year);
+  }
+  if (!episode.anime_type().empty())
+    title_episode.set_anime_type(episode.anime_type());
+  if (!episode.episode_title().empty())
+    title_episode.set_episode_title(episode.episode_title());
+
+  ExtendAnimeTitle(title_episode);
+
+  title = title_episode.anime_title();
+  return true;
+}
+
+Engine::DirectoryTitle Engine::FindDirectoryTitle(
+    const std::wstring& folder) const {
+  std::wstring path = folder;
 
   for (const auto& library_folder : taiga::settings.GetLibraryFolders()) {
     if (StartsWith(path, library_folder)) {
@@ -380,6 +718,28 @@ bool Engine::GetTitleFromPath(anime::Episode& episode) {
   }
 
   Trim(path, L"\\/");
+
+  // Files in the same directory share the same result, so it's computed once
+  // for all of them.
+  {
+    std::lock_guard lock{directory_cache_mutex_};
+    if (const auto directory_title = directory_cache_.Find(path)) {
+      RECOGNITION_COUNT_HIT(TitleFromPath);
+      return *directory_title;
+    }
+  }
+
+  auto directory_title = GetDirectoryTitle(path);
+
+  std::lock_guard lock{directory_cache_mutex_};
+  directory_cache_.Insert(path, directory_title);
+  return directory_title;
+}
+
+Engine::DirectoryTitle Engine::GetDirectoryTitle(
+    const std::wstring& path) const {
+  DirectoryTitle directory_title;
+
   std::vector<std::wstring> directories;
   Tokenize(path, L"\\/", directories);
 
@@ -423,17 +783,15 @@ bool Engine::GetTitleFromPath(anime::Episode& episode) {
       break;
     int number = get_season_number(directory);
     if (number) {
-      if (!episode.anime_season())
-        episode.set_anime_season(number);
+      if (!directory_title.season)
+        directory_title.season = number;
     } else {
-      episode.set_anime_title(directory);
+      directory_title.title = directory;
       break;
     }
   }
 
-  if (episode.anime_title().empty()) {
-    return false;
-  } else {
+  if (!directory_title.title.empty()) {
     // We're parsing the directory name in case it looks like
     // "[Fansub] Anime Title [Stuff]" rather than just "Anime Title".
     anitomy::Anitomy anitomy_instance;
@@ -441,34 +799,16 @@ bool Engine::GetTitleFromPath(anime::Episode& episode) {
     anitomy_instance.options().parse_episode_title = false;
     anitomy_instance.options().parse_file_extension = false;
     anitomy_instance.options().parse_release_group = true;
-    if (anitomy_instance.Parse(episode.anime_title())) {
+    if (anitomy_instance.Parse(directory_title.title)) {
       auto& elements = anitomy_instance.elements();
-      const auto valid_elements = {
-        anitomy::kElementAnimeTitle,
-        anitomy::kElementAnimeYear
-      };
-      for (const auto& element : valid_elements) {
-        if (!elements.empty(element))
-          episode.SetElementValue(element, elements.get(element));
-      }
+      if (!elements.empty(anitomy::kElementAnimeTitle))
+        directory_title.title = elements.get(anitomy::kElementAnimeTitle);
+      if (!elements.empty(anitomy::kElementAnimeYear))
+        directory_title.year = elements.get(anitomy::kElementAnimeYear);
     }
   }
 
-  auto find_number_in_string = [](const std::wstring& str) {
-    auto it = std::find_if(str.begin(), str.end(), IsNumericChar);
-    return it == str.end() ? str.npos : (it - str.begin());
-  };
-
-  if (episode.elements().empty(anitomy::kElementEpisodeNumber)) {
-    const auto& filename = episode.file_name();
-    auto pos = find_number_in_string(filename);
-    if (pos == 0)  // begins with a number (e.g. "01.mkv", "02 - Title.mkv")
-      episode.set_episode_number(ToInt(filename.substr(pos)));
-  }
-
-  ExtendAnimeTitle(episode);
-
-  return true;
+  return directory_title;
 }
 
 }  // namespace track::recognition
@@ -18,12 +18,23 @@
 
 #pragma once
 
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include <anitomy/anitomy/element.h>
+
+#include "base/lru_cache.h"
+#include "base/parallel.h"
 #include "base/string.h"
+#include "track/recognition_titles.h"
 
 namespace anime {
 class Episode;
@@ -32,6 +43,8 @@ class Item;
 
 namespace track::recognition {
 
+class SnapshotReader;
+
 using scores_t = std::map<int, double>;
 using sorted_scores_t = std::vector<std::pair<int, double>>;
 
@@ -48,17 +61,57 @@ struct MatchOptions {
   bool streaming_media = false;
 };
 
+// Holds the state of a single identification, so that the engine itself can
+// be shared between threads.
+struct Result {
+  sorted_scores_t scores;
+};
+
 class Engine {
 public:
+  ~Engine();
+
   bool Parse(std::wstring filename, const ParseOptions& parse_options, anime::Episode& episode) const;
   int Identify(anime::Episode& episode, bool give_score, const MatchOptions& match_options);
   bool Search(const std::wstring& title, std::vector<int>& anime_ids);
 
+  // Reentrant versions of the functions above. Titles must be initialized
+  // beforehand, and scores are written to the caller-owned result.
+  int Identify(anime::Episode& episode, bool give_score, const MatchOptions& match_options, Result& result) const;
+  bool Search(const std::wstring& title, std::vector<int>& anime_ids, Result& result) const;
+
+  // Parses and identifies many items at once on a pool of worker threads.
+  // Episodes are returned in the same order as their filenames.
+  void IdentifyBatch(const std::vector<std::wstring>& filenames, const ParseOptions& parse_options, const MatchOptions& match_options, std::vector<anime::Episode>& episodes);
+  void IdentifyBatch(std::vector<anime::Episode>& episodes, const MatchOptions& match_options);
+
+  // Loads the title index and relations from the snapshot on disk, or
+  // rebuilds them if the snapshot is stale. PrepareTitles does this on a
+  // worker thread, and InitializeTitles waits for it to finish.
+  void PrepareTitles();
   void InitializeTitles();
+  // Waits for the background load to finish writing the snapshot. Must be
+  // called before the application exits, while the database still exists.
+  void Shutdown();
   void UpdateTitles(const anime::Item& anime_item, bool erase_ids = false);
 
   sorted_scores_t GetScores() const;
 
+  struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t size = 0;
+  };
+  CacheStats GetCacheStats() const;
+  void ClearCache();
+
+  CacheStats GetParseCacheStats() const;
+
+  // Changes whenever a filename could be identified differently, i.e. when
+  // titles, relations, or the details that matches are validated against
+  // change. Results that are stored with the stamp can be used until then.
+  uint64_t GetRecognitionStamp() const;
+
   bool IsBatchRelease(const anime::Episode& episode) const;
   bool IsValidAnimeType(const anime::Episode& episode) const;
   bool IsValidAnimeType(const std::wstring& path, const ParseOptions& parse_options) const;
@@ -83,27 +136,90 @@ private:
   bool ValidateOptions(anime::Episode& episode, const anime::Item& anime_item, const MatchOptions& match_options, bool redirect) const;
   bool ValidateEpisodeNumber(anime::Episode& episode, const anime::Item& anime_item, const MatchOptions& match_options, bool redirect) const;
 
-  int LookUpTitle(std::wstring title, std::set<int>& anime_ids) const;
-  bool GetTitleFromPath(anime::Episode& episode);
+  // Elements of a filename, as they are after the anime title is extended
+  struct ParsedFilename {
+    bool parsed = false;
+    anitomy::Elements elements;
+  };
+  std::shared_ptr<const ParsedFilename> ParseFilename(const std::wstring& filename, const ParseOptions& parse_options) const;
+
+  int LookUpTitle(const std::wstring& title, std::set<int>& anime_ids) const;
+  bool GetTitleFromPath(anime::Episode& episode) const;
+  bool GetTitleFromPath(const anime::Episode& episode, std::wstring& title) const;
+
+  // Elements of an anime title that are derived from a directory path
+  struct DirectoryTitle {
+    std::wstring title;
+    std::wstring year;
+    int season = 0;
+  };
+  DirectoryTitle FindDirectoryTitle(const std::wstring& folder) const;
+  DirectoryTitle GetDirectoryTitle(const std::wstring& path) const;
   void ExtendAnimeTitle(anime::Episode& episode) const;
 
-  int ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids, const MatchOptions& match_options);
-  int ScoreTitle(const std::wstring& str, const anime::Episode& episode, const scores_t& trigram_results);
+  int ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids, const MatchOptions& match_options, Result& result) const;
+  int ScoreTitle(const std::wstring& str, const anime::Episode& episode, const scores_t& trigram_results, Result& result) const;
+
+  // Normalized forms of a query title, as used for looking up and scoring
+  struct NormalizedTitle {
+    std::wstring trigram_title;
+    std::wstring lookup_title;
+    std::wstring full_title;
+    trigram_container_t trigrams;
+  };
+  std::shared_ptr<const NormalizedTitle> GetNormalizedTitle(const std::wstring& title) const;
 
   void Normalize(std::wstring& title, int type, bool normalized_before) const;
-  void NormalizeUnicode(std::wstring& str) const;
   void ErasePunctuation(std::wstring& str, int type, bool modified_tail) const;
-  void EraseUnnecessary(std::wstring& str) const;
-  void ConvertOrdinalNumbers(std::wstring& str) const;
-  void ConvertRomanNumbers(std::wstring& str) const;
-  void ConvertSeasonNumbers(std::wstring& str) const;
-  void Transliterate(std::wstring& str) const;
+
+  enum TitleType {
+    kTitleMain,
+    kTitleAlternative,
+    kTitleUser,
+  };
+
+  // Titles of an anime, as they are before normalization
+  struct ItemTitles {
+    int id = 0;
+    std::vector<std::pair<TitleType, std::wstring>> titles;
+  };
+
+  // A title of an anime in all of its normalized forms
+  struct IndexedTitle {
+    TitleType type = kTitleMain;
+    std::wstring normal_title;
+    trigram_container_t trigrams;
+    std::wstring lookup_title;
+    std::wstring full_title;
+  };
+  using indexed_titles_t = std::vector<std::pair<int, std::vector<IndexedTitle>>>;
+
+  static ItemTitles GetItemTitles(const anime::Item& anime_item);
+  static uint64_t GetTitlesStamp(const std::vector<ItemTitles>& items);
+  static uint64_t GetRelationsStamp();
+  void IndexTitles(const ItemTitles& item_titles, std::vector<IndexedTitle>& indexed_titles) const;
+  void AddTitles(int anime_id, const std::vector<IndexedTitle>& indexed_titles, bool erase_ids);
+  void LoadTitles(bool background);
+
+  bool ReadSnapshot(uint64_t titles_stamp, uint64_t relations_stamp, indexed_titles_t& indexed_titles, bool& relations_loaded);
+  std::string WriteRelationsSnapshot() const;
+  bool ReadRelationsSnapshot(SnapshotReader& reader);
+  static void WriteSnapshot(uint64_t titles_stamp, const indexed_titles_t& indexed_titles, uint64_t relations_stamp, const std::string& relations);
 
   struct Titles {
-    using container_t = std::map<std::wstring, std::set<int>>;
+    using container_t = TitleDictionary;
     container_t alternative;
     container_t main;
     container_t user;
+
+    container_t& get(TitleType type) {
+      switch (type) {
+        default:
+        case kTitleMain: return main;
+        case kTitleAlternative: return alternative;
+        case kTitleUser: return user;
+      }
+    }
   } normal_titles_, titles_;
 
   struct ScoreStore {
@@ -111,7 +227,63 @@ private:
     std::vector<trigram_container_t> trigrams;
   };
   std::map<int, ScoreStore> db_;
+  std::map<trigram_t, std::vector<int>> trigram_index_;
+
+  // Title indexes and relations are read under a shared lock, and written
+  // under an exclusive one.
+  mutable std::shared_mutex mutex_;
+  std::once_flag titles_initialized_;
+
+  // Loads the title index in the background. Titles that are updated in the
+  // meantime are applied again after the index is loaded.
+  std::thread build_thread_;
+  std::shared_future<void> titles_ready_;
+  bool building_titles_ = false;
+  indexed_titles_t pending_titles_;
+
+  // Scores of the last call to the non-reentrant functions, for the UI
+  mutable std::mutex scores_mutex_;
   sorted_scores_t scores_;
+
+  // Normalized forms of recent query titles. The same titles are identified
+  // over and over (e.g. feed items, player windows, files in a folder).
+  mutable std::mutex cache_mutex_;
+  mutable base::LruCache<std::wstring, std::shared_ptr<const NormalizedTitle>> cache_{2048};
+
+  // Parse results of recent filenames. Quick scans and media detection parse
+  // the same filenames repeatedly. Entries are keyed by the revision of the
+  // ignored strings, so that a change in settings makes them unreachable.
+  struct ParseKey {
+    std::wstring filename;
+    bool streaming_media = false;
+    size_t revision = 0;
+
+    bool operator==(const ParseKey& key) const {
+      return revision == key.revision &&
+             streaming_media == key.streaming_media &&
+             filename == key.filename;
+    }
+  };
+  struct ParseKeyHash {
+    size_t operator()(const ParseKey& key) const {
+      return std::hash<std::wstring>{}(key.filename) ^
+             (key.revision << 1 | static_cast<size_t>(key.streaming_media));
+    }
+  };
+  mutable std::mutex parse_cache_mutex_;
+  mutable base::LruCache<ParseKey, std::shared_ptr<const ParsedFilename>, ParseKeyHash> parse_cache_{4096};
+  mutable std::wstring ignored_strings_;
+  mutable std::vector<std::wstring> ignored_string_list_;
+  mutable size_t ignored_strings_revision_ = 0;
+
+  // Titles derived from recent directories, relative to library folders.
+  // Files of the same directory are usually recognized one after another.
+  mutable std::mutex directory_cache_mutex_;
+  mutable base::LruCache<std::wstring, DirectoryTitle> directory_cache_{256};
+
+  // Runs batches of identifications. Threads are created once and reused by
+  // every batch.
+  base::ThreadPool thread_pool_;
 };
 
 }  // namespace track::recognition
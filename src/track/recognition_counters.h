@@ -0,0 +1,140 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include "taiga/config.h"
+
+namespace track::recognition {
+
+enum class Counter {
+  Parse,
+  Normalize,
+  NormalizedTitle,
+  LookUpTitle,
+  ScoreTitle,
+  ValidateOptions,
+  SearchEpisodeRedirection,
+  TitleFromPath,
+};
+
+constexpr size_t kCounterCount =
+    static_cast<size_t>(Counter::TitleFromPath) + 1;
+
+constexpr std::wstring_view GetCounterName(const Counter counter) {
+  switch (counter) {
+    case Counter::Parse: return L"Parse";
+    case Counter::Normalize: return L"Normalize";
+    case Counter::NormalizedTitle: return L"NormalizedTitle";
+    case Counter::LookUpTitle: return L"LookUpTitle";
+    case Counter::ScoreTitle: return L"ScoreTitle";
+    case Counter::ValidateOptions: return L"ValidateOptions";
+    case Counter::SearchEpisodeRedirection: return L"SearchEpisodeRedirection";
+    case Counter::TitleFromPath: return L"TitleFromPath";
+  }
+  return L"";
+}
+
+struct CounterValues {
+  uint64_t calls = 0;
+  uint64_t hits = 0;  // cache hits, where the function has a cache
+  uint64_t nanoseconds = 0;  // including nested calls
+};
+
+// Call counts and cumulative times of the functions on the recognition path.
+// Values are updated with relaxed atomics, and each counter has its own cache
+// line, so that worker threads do not contend for them.
+class Counters {
+public:
+  void Add(const Counter counter, const uint64_t nanoseconds) {
+    auto& entry = entries_[static_cast<size_t>(counter)];
+    entry.calls.fetch_add(1, std::memory_order_relaxed);
+    entry.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+  }
+
+  void AddHit(const Counter counter) {
+    auto& entry = entries_[static_cast<size_t>(counter)];
+    entry.hits.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  CounterValues Get(const Counter counter) const {
+    const auto& entry = entries_[static_cast<size_t>(counter)];
+    return {
+      entry.calls.load(std::memory_order_relaxed),
+      entry.hits.load(std::memory_order_relaxed),
+      entry.nanoseconds.load(std::memory_order_relaxed),
+    };
+  }
+
+  void Reset() {
+    for (auto& entry : entries_) {
+      entry.calls.store(0, std::memory_order_relaxed);
+      entry.hits.store(0, std::memory_order_relaxed);
+      entry.nanoseconds.store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct alignas(64) Entry {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> nanoseconds{0};
+  };
+
+  std::array<Entry, kCounterCount> entries_;
+};
+
+inline Counters counters;
+
+class ScopedCounter {
+public:
+  explicit ScopedCounter(const Counter counter) : counter_{counter} {}
+  ScopedCounter(const ScopedCounter&) = delete;
+  ScopedCounter& operator=(const ScopedCounter&) = delete;
+
+  ~ScopedCounter() {
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_t::now() - t0_);
+    counters.Add(counter_, duration.count());
+  }
+
+private:
+  using clock_t = std::chrono::steady_clock;
+
+  Counter counter_;
+  clock_t::time_point t0_{clock_t::now()};
+};
+
+}  // namespace track::recognition
+
+#ifdef TAIGA_RECOGNITION_COUNTERS
+#define RECOGNITION_COUNT(counter) \
+    ::track::recognition::ScopedCounter recognition_counter_{ \
+        ::track::recognition::Counter::counter}
+#define RECOGNITION_COUNT_HIT(counter) \
+    ::track::recognition::counters.AddHit( \
+        ::track::recognition::Counter::counter)
+#else
+#define RECOGNITION_COUNT(counter)
+#define RECOGNITION_COUNT_HIT(counter)
+#endif
@@ -16,19 +16,26 @@
 ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
 #include <regex>
+#include <string_view>
+#include <tuple>
 
 #include <semaver.hpp>
 
 #include "track/recognition.h"
 
 #include "base/file.h"
-#include "base/format.h"
 #include "base/log.h"
 #include "sync/service.h"
 #include "taiga/path.h"
 #include "taiga/settings.h"
 #include "taiga/version.h"
+#include "track/recognition_counters.h"
+#include "track/recognition_snapshot.h"
 
 namespace track::recognition {
 
@@ -36,20 +43,50 @@ class Relation {
 public:
   using int_pair_t = std::pair<int, int>;
 
-  void AddRange(int id, int_pair_t r1, int_pair_t r2);
-  bool FindRange(int episode_number, int_pair_t& result) const;
-
-private:
   struct Range {
     int id;
     int_pair_t r0;
     int_pair_t r1;
   };
 
+  void AddRange(int id, int_pair_t r1, int_pair_t r2);
+  void Compile();
+  bool FindRange(int episode_number, int_pair_t& result) const;
+
+  const std::vector<Range>& ranges() const { return ranges_; }
+
+private:
+  // Episodes that a range applies to. Ranges may overlap, in which case the
+  // first one wins, so they are split into sorted and disjoint intervals.
+  struct Interval {
+    int first;
+    int last;
+    size_t range;
+  };
+
   std::vector<Range> ranges_;
+  std::vector<Interval> intervals_;
 };
 
-std::map<int, Relation> relations;
+// Relations are read for all services at once, so that changing the active
+// service does not require reading the file again.
+using relations_t = std::map<int, Relation>;
+using service_relations_t = std::array<relations_t, 3>;
+
+service_relations_t relations;
+
+static const relations_t* GetCurrentRelations() {
+  switch (sync::GetCurrentServiceId()) {
+    case sync::ServiceId::MyAnimeList:
+      return &relations[0];
+    case sync::ServiceId::Kitsu:
+      return &relations[1];
+    case sync::ServiceId::AniList:
+      return &relations[2];
+    default:
+      return nullptr;
+  }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -57,82 +94,174 @@ void Relation::AddRange(int id, int_pair_t r1, int_pair_t r2) {
   ranges_.push_back({id, r1, r2});
 }
 
-bool Relation::FindRange(int episode_number, int_pair_t& result) const {
-  for (const auto& it : ranges_) {
-    int distance = episode_number - it.r0.first;
-    if (distance >= 0) {
-      if (it.r0.second - episode_number >= 0) {
-        int destination = it.r1.first;
-        if (it.r1.first != it.r1.second)
-          destination += distance;
-        if (destination <= it.r1.second) {
-          result.first = it.id;
-          result.second = destination;
-          return true;
+void Relation::Compile() {
+  // A range does not apply to episodes that would be redirected past the end
+  // of its destination.
+  auto get_interval = [](const Range& range) {
+    int64_t first = range.r0.first;
+    int64_t last = range.r0.second;
+    if (range.r1.first != range.r1.second) {
+      last = std::min<int64_t>(
+          last, first + range.r1.second - int64_t{range.r1.first});
+    }
+    return std::make_pair(first, last);
+  };
+
+  std::vector<int64_t> bounds;
+  for (const auto& range : ranges_) {
+    const auto [first, last] = get_interval(range);
+    if (first <= last) {
+      bounds.push_back(first);
+      bounds.push_back(last + 1);
+    }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+  intervals_.clear();
+
+  for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+    const int first = static_cast<int>(bounds[i]);
+    const int last = static_cast<int>(bounds[i + 1] - 1);
+    for (size_t j = 0; j < ranges_.size(); ++j) {
+      const auto interval = get_interval(ranges_[j]);
+      if (interval.first <= first && last <= interval.second) {
+        if (!intervals_.empty() && intervals_.back().range == j &&
+            intervals_.back().last + int64_t{1} == first) {
+          intervals_.back().last = last;
+        } else {
+          intervals_.push_back({first, last, j});
         }
+        break;
       }
     }
   }
-
-  return false;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+bool Relation::FindRange(int episode_number, int_pair_t& result) const {
+  auto it = std::upper_bound(
+      intervals_.begin(), intervals_.end(), episode_number,
+      [](int number, const Interval& interval) {
+        return number < interval.first;
+      });
 
-static bool ParseRule(const std::wstring& rule) {
-  constexpr auto id_pattern = L"((?:\\d+|[?~])(?:\\|(?:\\d+|[?~]))*)";
-  constexpr auto episode_pattern = L"(\\d+)(?:-(\\d+|\\?))?";
-  static const std::wregex pattern(
-      L"{0}:{1} -> {0}:{1}(!)?"_format(id_pattern, episode_pattern));
+  if (it == intervals_.begin())
+    return false;
+  if (episode_number > (--it)->last)
+    return false;
 
-  std::match_results<std::wstring::const_iterator> match_results;
+  const auto& range = ranges_[it->range];
+  result.first = range.id;
+  result.second = range.r1.first;
+  if (range.r1.first != range.r1.second)
+    result.second += episode_number - range.r0.first;
 
-  if (!std::regex_match(rule, match_results, pattern))
-    return false;
+  return true;
+}
 
-  auto get_id = [&](size_t index) {
-    std::vector<std::wstring> ids;
-    Split(match_results[index].str(), L"|", ids);
-    switch (sync::GetCurrentServiceId()) {
-      case sync::ServiceId::MyAnimeList:
-        return ids.size() > 0 ? ToInt(ids.at(0)) : 0;
-      case sync::ServiceId::Kitsu:
-        return ids.size() > 1 ? ToInt(ids.at(1)) : 0;
-      case sync::ServiceId::AniList:
-        return ids.size() > 2 ? ToInt(ids.at(2)) : 0;
-      default:
-        return 0;
-    }
-  };
+////////////////////////////////////////////////////////////////////////////////
 
-  auto get_range = [&](size_t first, size_t second) {
-    std::pair<int, int> range;
-    range.first = ToInt(match_results[first].str());
-    if (match_results[second].matched) {
-      if (IsNumericString(match_results[second].str())) {
-        range.second = ToInt(match_results[second].str());
-      } else {
+// Rules are in the form of "ids:episodes -> ids:episodes", with an optional
+// "!" at the end. IDs are separated by "|", one for each service, where "?"
+// stands for an unknown ID and "~" for the same ID as on the left. Episodes
+// are either a number or a range, where "?" stands for an unknown end.
+class RuleParser {
+public:
+  explicit RuleParser(std::wstring_view rule) : rule_{rule} {}
+
+  using ids_t = std::array<int, std::tuple_size_v<service_relations_t>>;
+
+  bool ParseIds(ids_t& ids) {
+    ids.fill(0);
+    size_t column = 0;
+    do {
+      int id = 0;
+      if (!Skip(L'?') && !Skip(L'~') && !ParseNumber(id))
+        return false;
+      if (column < ids.size())
+        ids[column] = id;
+      ++column;
+    } while (Skip(L'|'));
+    return true;
+  }
+
+  bool ParseEpisodes(std::pair<int, int>& range) {
+    if (!ParseNumber(range.first))
+      return false;
+    if (Skip(L'-')) {
+      if (Skip(L'?')) {
         range.second = INT_MAX;
+      } else if (!ParseNumber(range.second)) {
+        return false;
       }
     } else {
       range.second = range.first;
     }
-    return range;
-  };
+    return true;
+  }
+
+  bool Skip(wchar_t c) {
+    if (pos_ < rule_.size() && rule_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool Skip(std::wstring_view str) {
+    if (rule_.substr(pos_, str.size()) == str) {
+      pos_ += str.size();
+      return true;
+    }
+    return false;
+  }
+
+  bool AtEnd() const { return pos_ == rule_.size(); }
+
+private:
+  bool ParseNumber(int& value) {
+    const size_t begin = pos_;
+    int64_t number = 0;
+    for (; pos_ < rule_.size() && IsNumericChar(rule_[pos_]); ++pos_) {
+      number = std::min<int64_t>(number * 10 + (rule_[pos_] - L'0'), INT_MAX);
+    }
+    value = static_cast<int>(number);
+    return pos_ > begin;
+  }
+
+  std::wstring_view rule_;
+  size_t pos_ = 0;
+};
+
+static bool ParseRule(const std::wstring& rule,
+                      service_relations_t& service_relations) {
+  RuleParser parser{rule};
+
+  RuleParser::ids_t ids0;
+  RuleParser::ids_t ids1;
+  std::pair<int, int> r0;
+  std::pair<int, int> r1;
 
-  const int id0 = get_id(1);
-  if (id0) {
-    const auto r0 = get_range(2, 3);
+  if (!parser.ParseIds(ids0) || !parser.Skip(L':') ||
+      !parser.ParseEpisodes(r0) || !parser.Skip(L" -> ") ||
+      !parser.ParseIds(ids1) || !parser.Skip(L':') ||
+      !parser.ParseEpisodes(r1)) {
+    return false;
+  }
+  const bool redirect_self = parser.Skip(L'!');
+  if (!parser.AtEnd())
+    return false;
 
-    int id1 = get_id(4);
-    if (!id1)
-      id1 = id0;
-    const auto r1 = get_range(5, 6);
+  for (size_t i = 0; i < service_relations.size(); ++i) {
+    const int id0 = ids0[i];
+    if (!id0)
+      continue;
+    const int id1 = ids1[i] ? ids1[i] : id0;
 
-    relations[id0].AddRange(id1, r0, r1);
+    service_relations[i][id0].AddRange(id1, r0, r1);
 
-    if (match_results[7].matched)
-      relations[id1].AddRange(id1, r0, r1);
+    if (redirect_self)
+      service_relations[i][id1].AddRange(id1, r0, r1);
   }
 
   return true;
@@ -152,7 +281,7 @@ bool Engine::ReadRelations() {
 }
 
 bool Engine::ReadRelations(const std::string& document) {
-  relations.clear();
+  service_relations_t document_relations;
 
   std::vector<std::wstring> lines;
   Split(StrToWstr(document), L"\n", lines);
@@ -204,14 +333,93 @@ bool Engine::ReadRelations(const std::string& document) {
       }
       case FileSection::Rules: {
         TrimLeft(line, L"- ");
-        if (!ParseRule(line))
+        if (!ParseRule(line, document_relations))
           LOGW(L"Could not parse rule: {}", line);
         break;
       }
     }
   }
 
-  return !relations.empty();
+  for (auto& service_relation : document_relations) {
+    for (auto& [id, relation] : service_relation) {
+      relation.Compile();
+    }
+  }
+
+  const bool empty = std::all_of(
+      document_relations.begin(), document_relations.end(),
+      [](const relations_t& service_relation) {
+        return service_relation.empty();
+      });
+
+  {
+    std::lock_guard lock{mutex_};
+    relations.swap(document_relations);
+  }
+
+  // Cached results are not valid for the new relations
+  ClearCache();
+
+  return !empty;
+}
+
+std::string Engine::WriteRelationsSnapshot() const {
+  std::shared_lock lock{mutex_};
+
+  SnapshotWriter writer;
+  for (const auto& service_relation : relations) {
+    writer.Write(static_cast<uint32_t>(service_relation.size()));
+    for (const auto& [id, relation] : service_relation) {
+      writer.Write(id);
+      writer.Write(static_cast<uint32_t>(relation.ranges().size()));
+      for (const auto& range : relation.ranges()) {
+        writer.Write(range.id);
+        writer.Write(range.r0.first);
+        writer.Write(range.r0.second);
+        writer.Write(range.r1.first);
+        writer.Write(range.r1.second);
+      }
+    }
+  }
+
+  return std::move(writer.data());
+}
+
+bool Engine::ReadRelationsSnapshot(SnapshotReader& reader) {
+  service_relations_t snapshot_relations;
+
+  for (auto& service_relation : snapshot_relations) {
+    uint32_t relation_count = 0;
+    if (!reader.Read(relation_count))
+      return false;
+
+    for (uint32_t i = 0; i < relation_count; ++i) {
+      int id = 0;
+      uint32_t range_count = 0;
+      if (!reader.Read(id) || !reader.Read(range_count))
+        return false;
+      auto& relation = service_relation[id];
+      for (uint32_t j = 0; j < range_count; ++j) {
+        Relation::Range range{};
+        if (!reader.Read(range.id) ||
+            !reader.Read(range.r0.first) || !reader.Read(range.r0.second) ||
+            !reader.Read(range.r1.first) || !reader.Read(range.r1.second)) {
+          return false;
+        }
+        relation.AddRange(range.id, range.r0, range.r1);
+      }
+      relation.Compile();
+    }
+  }
+
+  {
+    std::lock_guard lock{mutex_};
+    relations.swap(snapshot_relations);
+  }
+
+  ClearCache();
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -219,10 +427,15 @@ bool Engine::ReadRelations(const std::string& document) {
 bool Engine::SearchEpisodeRedirection(
     int id, const std::pair<int, int>& range,
     int& destination_id, std::pair<int, int>& destination_range) const {
+  RECOGNITION_COUNT(SearchEpisodeRedirection);
+
+  const auto current_relations = GetCurrentRelations();
+  if (!current_relations)
+    return false;
 
-  auto it = relations.find(id);
+  auto it = current_relations->find(id);
 
-  if (it == relations.end())
+  if (it == current_relations->end())
     return false;
 
   const auto& relation = it->second;
@@ -17,6 +17,8 @@
 */
 
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
 #include "track/recognition.h"
 
@@ -24,26 +26,32 @@
 #include "media/anime_db.h"
 #include "media/anime_util.h"
 #include "track/episode.h"
+#include "track/recognition_counters.h"
 #include "ui/translate.h"
 
 namespace track::recognition {
 
 sorted_scores_t Engine::GetScores() const {
+  std::lock_guard lock{scores_mutex_};
   return scores_;
 }
 
 int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
-                       const MatchOptions& match_options) {
-  scores_t trigram_results;
+                       const MatchOptions& match_options,
+                       Result& result) const {
+  RECOGNITION_COUNT(ScoreTitle);
 
-  auto normal_title = episode.anime_title();
-  Normalize(normal_title, kNormalizeForTrigrams, false);
+  scores_t trigram_results;
 
-  trigram_container_t t1;
-  GetTrigrams(normal_title, t1);
+  const auto normalized_title = GetNormalizedTitle(episode.anime_title());
+  const auto& normal_title = normalized_title->trigram_title;
+  const auto& t1 = normalized_title->trigrams;
 
   auto calculate_trigram_results = [&](int anime_id) {
-    for (const auto& t2 : db_[anime_id].trigrams) {
+    const auto it = db_.find(anime_id);
+    if (it == db_.end())
+      return;
+    for (const auto& t2 : it->second.trigrams) {
       double result = CompareTrigrams(t1, t2);
       if (result > 0.1) {
         auto& target = trigram_results[anime_id];
@@ -57,13 +65,30 @@ int Engine::ScoreTitle(anime::Episode& episode, const std::set<int>& anime_ids,
       calculate_trigram_results(id);
     }
   } else {
-    for (const auto& it : anime::db.items) {
-      if (ValidateOptions(episode, it.second, match_options, false))
-        calculate_trigram_results(it.first);
+    // Titles that don't share any trigrams with the query can't score above
+    // the threshold, so we only need to check the IDs found in the index.
+    std::vector<int> candidate_ids;
+    for (auto it = t1.begin(); it != t1.end(); ++it) {
+      if (it != t1.begin() && *it == *(it - 1))
+        continue;  // Trigrams are sorted, so we can skip duplicates
+      auto index_it = trigram_index_.find(*it);
+      if (index_it != trigram_index_.end())
+        candidate_ids.insert(candidate_ids.end(),
+                             index_it->second.begin(), index_it->second.end());
+    }
+    std::sort(candidate_ids.begin(), candidate_ids.end());
+    candidate_ids.erase(std::unique(candidate_ids.begin(), candidate_ids.end()),
+                        candidate_ids.end());
+
+    for (const auto& id : candidate_ids) {
+      const auto anime_item = anime::db.Find(id, false);
+      if (anime_item &&
+          ValidateOptions(episode, *anime_item, match_options, false))
+        calculate_trigram_results(id);
     }
   }
 
-  return ScoreTitle(normal_title, episode, trigram_results);
+  return ScoreTitle(normal_title, episode, trigram_results, result);
 }
 
 static double CustomScore(const std::wstring& title, const std::wstring& str) {
@@ -113,47 +138,129 @@ static double BonusScore(const anime::Episode& episode, int id) {
   return score;
 };
 
+static double LengthRatio(const std::wstring& title, const std::wstring& str) {
+  const auto length_max = std::max(title.size(), str.size());
+  if (!length_max)
+    return 0.0;
+  return static_cast<double>(std::min(title.size(), str.size())) / length_max;
+}
+
+static double WeightedScore(double jaro_winkler, double custom,
+                            double levenshtein, double trigram, double bonus) {
+  return (((1.0 * jaro_winkler) +
+           (0.5 * std::pow(custom, 0.66)) +
+           (0.3 * std::pow(levenshtein, 0.8)) +
+           (0.2 * std::pow(trigram, 0.8))) / 2.0) + bonus;
+}
+
+// Returns the highest score that a title can get, given the ratio of its
+// length to the length of the query. This is much cheaper than calculating the
+// actual score, and allows us to skip the titles that can't make it to the
+// top.
+static double UpperBoundScore(double length_ratio, double trigram,
+                              double bonus) {
+  // At most min(len1, len2) characters can match, and up to 4 characters of
+  // the common prefix are rewarded
+  const double jaro = (2.0 + length_ratio) / 3.0;
+  const double jaro_winkler = jaro + (4 * 0.1 * (1.0 - jaro));
+  // Containing strings are scored by their length ratio, others can get up to
+  // 0.7 for their common prefix (see CustomScore)
+  const double custom = std::max(length_ratio, 0.7);
+  // At least max(len1, len2) - min(len1, len2) edits are required
+  const double levenshtein = length_ratio;
+
+  // Leave some room for rounding errors
+  constexpr double kEpsilon = 1e-9;
+
+  return WeightedScore(jaro_winkler, custom, levenshtein, trigram, bonus) +
+         kEpsilon;
+}
+
 int Engine::ScoreTitle(const std::wstring& str, const anime::Episode& episode,
-                       const scores_t& trigram_results) {
-  scores_t jaro_winkler, levenshtein, custom, bonus;
+                       const scores_t& trigram_results, Result& result) const {
+  constexpr size_t kMaxScores = 20;
+  constexpr double kMinScore = 0.3;
 
-  scores_.clear();
+  struct Candidate {
+    int id;
+    double trigram_score;
+    double bonus_score;
+    double upper_bound;
+    const ScoreStore* score_store;
+  };
 
-  for (const auto& trigram_result : trigram_results) {
-    int id = trigram_result.first;
+  thread_local std::vector<Candidate> candidates;
+  candidates.clear();
+  candidates.reserve(trigram_results.size());
+
+  for (const auto& [id, trigram_score] : trigram_results) {
+    const auto& score_store = db_.at(id);
+    double length_ratio = 0.0;
+    for (const auto& title : score_store.normal_titles) {
+      length_ratio = std::max(length_ratio, LengthRatio(title, str));
+    }
+    const double bonus_score = BonusScore(episode, id);
+    candidates.push_back({id, trigram_score, bonus_score,
+                          UpperBoundScore(length_ratio, trigram_score, bonus_score),
+                          &score_store});
+  }
+
+  // Candidates with higher upper bounds are more likely to make it to the top,
+  // so they are scored first to raise the threshold early
+  std::sort(candidates.begin(), candidates.end(),
+      [](const Candidate& a, const Candidate& b) {
+        return a.upper_bound > b.upper_bound;
+      });
+
+  // Scores are sorted in descending order, with ties broken by ID
+  const auto is_better = [](const std::pair<int, double>& a,
+                            const std::pair<int, double>& b) {
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+  };
+
+  // Holds the top scores in a heap, with the lowest score at the front
+  auto& scores = result.scores;
+  scores.clear();
+
+  for (const auto& candidate : candidates) {
+    const double threshold = scores.size() < kMaxScores ?
+        kMinScore : std::max(kMinScore, scores.front().second);
+    if (candidate.upper_bound < threshold)
+      break;  // Neither this nor any of the remaining candidates can make it
 
     // Calculate individual scores for all titles
-    for (auto& title : db_[id].normal_titles) {
-      jaro_winkler[id] = std::max(jaro_winkler[id], JaroWinklerDistance(title, str));
-      levenshtein[id] = std::max(levenshtein[id], LevenshteinDistance(title, str));
-      custom[id] = std::max(custom[id], CustomScore(title, str));
+    double jaro_winkler = 0.0, levenshtein = 0.0, custom = 0.0;
+    for (const auto& title : candidate.score_store->normal_titles) {
+      jaro_winkler = std::max(jaro_winkler, JaroWinklerDistance(title, str));
+      levenshtein = std::max(levenshtein, LevenshteinDistance(title, str));
+      custom = std::max(custom, CustomScore(title, str));
     }
-    bonus[id] = BonusScore(episode, id);
 
     // Calculate the average score for the ID
-    double score =
-        (((1.0 * jaro_winkler[id]) +
-          (0.5 * std::pow(custom[id], 0.66)) +
-          (0.3 * std::pow(levenshtein[id], 0.8)) +
-          (0.2 * std::pow(trigram_result.second, 0.8))) / 2.0) + bonus[id];
-    if (score >= 0.3)
-      scores_.push_back(std::make_pair(id, score));
+    const std::pair<int, double> score{
+        candidate.id,
+        WeightedScore(jaro_winkler, custom, levenshtein,
+                      candidate.trigram_score, candidate.bonus_score)};
+    if (score.second < kMinScore)
+      continue;
+
+    if (scores.size() < kMaxScores) {
+      scores.push_back(score);
+      std::push_heap(scores.begin(), scores.end(), is_better);
+    } else if (is_better(score, scores.front())) {
+      std::pop_heap(scores.begin(), scores.end(), is_better);
+      scores.back() = score;
+      std::push_heap(scores.begin(), scores.end(), is_better);
+    }
   }
 
-  // Sort scores in descending order, then limit the results
-  std::stable_sort(scores_.begin(), scores_.end(),
-      [&](const std::pair<int, double>& a,
-          const std::pair<int, double>& b) {
-        return a.second > b.second;
-      });
-  if (scores_.size() > 20)
-    scores_.resize(20);
+  std::sort_heap(scores.begin(), scores.end(), is_better);
 
-  double score_1st = scores_.size() > 0 ? scores_.at(0).second : 0.0;
-  double score_2nd = scores_.size() > 1 ? scores_.at(1).second : 0.0;
+  double score_1st = scores.size() > 0 ? scores.at(0).second : 0.0;
+  double score_2nd = scores.size() > 1 ? scores.at(1).second : 0.0;
 
   if (score_1st >= 1.0 && score_1st != score_2nd)
-    return scores_.front().first;
+    return scores.front().first;
 
   return anime::ID_UNKNOWN;
 }
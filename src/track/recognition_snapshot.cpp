@@ -0,0 +1,231 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "track/recognition.h"
+
+#include "base/file.h"
+#include "base/string.h"
+#include "media/anime_db.h"
+#include "media/anime_util.h"
+#include "sync/service.h"
+#include "taiga/path.h"
+#include "taiga/settings.h"
+#include "track/recognition_snapshot.h"
+
+namespace track::recognition {
+
+// Must be increased whenever the format or the normalization changes
+constexpr uint32_t kSnapshotVersion = 2;
+constexpr uint32_t kSnapshotMagic = 0x58444954;  // "TIDX"
+
+static uint64_t HashBytes(const void* data, size_t size, uint64_t hash) {
+  // FNV-1a
+  const auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211;
+  }
+  return hash;
+}
+
+template <typename T>
+static uint64_t HashValue(const T& value, uint64_t hash) {
+  return HashBytes(&value, sizeof(T), hash);
+}
+
+static uint64_t HashString(const std::wstring& str, uint64_t hash) {
+  hash = HashValue(str.size(), hash);
+  return HashBytes(str.data(), str.size() * sizeof(wchar_t), hash);
+}
+
+constexpr uint64_t kHashOffset = 14695981039346656037ULL;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The database is not saved on every change, so its file is not a reliable
+// stamp. Instead, we hash the titles that the index is built from, which is
+// much cheaper than normalizing them.
+uint64_t Engine::GetTitlesStamp(const std::vector<ItemTitles>& items) {
+  uint64_t hash = kHashOffset;
+
+  for (const auto& item : items) {
+    hash = HashValue(item.id, hash);
+    hash = HashValue(item.titles.size(), hash);
+    for (const auto& [type, title] : item.titles) {
+      hash = HashValue(type, hash);
+      hash = HashString(title, hash);
+    }
+  }
+
+  return hash;
+}
+
+// Relations are stamped with the modification date of their file. IDs are
+// read for all services at once, so the current one is not a part of it.
+uint64_t Engine::GetRelationsStamp() {
+  const auto path = taiga::GetPath(taiga::Path::DatabaseAnimeRelations);
+
+  uint64_t hash = kHashOffset;
+  hash = HashString(GetFileLastModifiedDate(path), hash);
+  hash = HashValue(GetFileSize(path), hash);
+
+  return hash;
+}
+
+uint64_t Engine::GetRecognitionStamp() const {
+  std::vector<ItemTitles> items;
+  items.reserve(anime::db.items.size());
+  for (const auto& [anime_id, anime_item] : anime::db.items) {
+    items.push_back(GetItemTitles(anime_item));
+  }
+
+  uint64_t hash = kHashOffset;
+  hash = HashValue(kSnapshotVersion, hash);
+  hash = HashValue(GetTitlesStamp(items), hash);
+  hash = HashValue(GetRelationsStamp(), hash);
+  hash = HashValue(sync::GetCurrentServiceId(), hash);
+
+  // Details that are used for scoring and validating matches
+  for (const auto& [anime_id, anime_item] : anime::db.items) {
+    const auto& date_start = anime_item.GetDateStart();
+    hash = HashValue(anime_id, hash);
+    hash = HashValue(anime_item.GetType(), hash);
+    hash = HashValue(anime_item.GetEpisodeCount(), hash);
+    hash = HashValue(date_start.year(), hash);
+    hash = HashValue(date_start.month(), hash);
+    hash = HashValue(date_start.day(), hash);
+    hash = HashValue(anime::IsAiredYet(anime_item), hash);
+  }
+
+  // Settings that change how filenames are parsed
+  hash = HashString(taiga::settings.GetRecognitionIgnoredStrings(), hash);
+  for (const auto& folder : taiga::settings.GetLibraryFolders()) {
+    hash = HashString(folder, hash);
+  }
+
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Titles are read only if their stamp matches, which is the return value.
+// Relations are read separately, as they change independently of titles.
+bool Engine::ReadSnapshot(uint64_t titles_stamp, uint64_t relations_stamp,
+                          indexed_titles_t& indexed_titles,
+                          bool& relations_loaded) {
+  relations_loaded = false;
+
+  FileMapping file;
+  if (!file.Open(taiga::GetPath(taiga::Path::DatabaseAnimeIndex)))
+    return false;
+
+  SnapshotReader reader{file.data(), file.size()};
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t char_size = 0;
+  if (!reader.Read(magic) || magic != kSnapshotMagic ||
+      !reader.Read(version) || version != kSnapshotVersion ||
+      !reader.Read(char_size) || char_size != sizeof(wchar_t)) {
+    return false;
+  }
+
+  const auto read_titles = [&indexed_titles](SnapshotReader& reader) {
+    uint32_t item_count = 0;
+    if (!reader.Read(item_count))
+      return false;
+    indexed_titles.resize(item_count);
+
+    for (auto& [anime_id, titles] : indexed_titles) {
+      uint32_t title_count = 0;
+      if (!reader.Read(anime_id) || !reader.Read(title_count))
+        return false;
+      titles.resize(title_count);
+
+      for (auto& title : titles) {
+        uint32_t type = 0;
+        if (!reader.Read(type) || type > static_cast<uint32_t>(kTitleUser) ||
+            !reader.Read(title.normal_title) ||
+            !reader.Read(title.trigrams) ||
+            !reader.Read(title.lookup_title) ||
+            !reader.Read(title.full_title)) {
+          return false;
+        }
+        title.type = static_cast<TitleType>(type);
+      }
+    }
+
+    return true;
+  };
+
+  uint64_t stamp = 0;
+  SnapshotReader section{nullptr, 0};
+
+  bool titles_loaded = false;
+  if (reader.Read(stamp) && reader.ReadSection(section) &&
+      stamp == titles_stamp) {
+    titles_loaded = read_titles(section);
+    if (!titles_loaded)
+      indexed_titles.clear();
+  }
+
+  if (reader.Read(stamp) && reader.ReadSection(section) &&
+      stamp == relations_stamp) {
+    relations_loaded = ReadRelationsSnapshot(section);
+  }
+
+  return titles_loaded;
+}
+
+void Engine::WriteSnapshot(uint64_t titles_stamp,
+                           const indexed_titles_t& indexed_titles,
+                           uint64_t relations_stamp,
+                           const std::string& relations) {
+  SnapshotWriter titles;
+  titles.Write(static_cast<uint32_t>(indexed_titles.size()));
+  for (const auto& [anime_id, item_titles] : indexed_titles) {
+    titles.Write(anime_id);
+    titles.Write(static_cast<uint32_t>(item_titles.size()));
+    for (const auto& title : item_titles) {
+      titles.Write(static_cast<uint32_t>(title.type));
+      titles.Write(title.normal_title);
+      titles.Write(title.trigrams);
+      titles.Write(title.lookup_title);
+      titles.Write(title.full_title);
+    }
+  }
+
+  SnapshotWriter writer;
+  writer.Write(kSnapshotMagic);
+  writer.Write(kSnapshotVersion);
+  writer.Write(static_cast<uint32_t>(sizeof(wchar_t)));
+  writer.Write(titles_stamp);
+  writer.WriteSection(titles.data());
+  writer.Write(relations_stamp);
+  writer.WriteSection(relations);
+
+  // Write to a temporary file first, so that a snapshot is never left
+  // half-written
+  const auto path = taiga::GetPath(taiga::Path::DatabaseAnimeIndex);
+  const auto temp_path = path + L".tmp";
+  if (SaveToFile(writer.data(), temp_path)) {
+    ::MoveFileEx(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+  }
+}
+
+}  // namespace track::recognition
@@ -0,0 +1,122 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace track::recognition {
+
+// Writes values to the snapshot of the title index. Values are stored in the
+// native byte order, as the snapshot is not meant to be shared between
+// machines.
+class SnapshotWriter {
+public:
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  void Write(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Write(static_cast<uint32_t>(values.size()));
+    data_.append(reinterpret_cast<const char*>(values.data()),
+                 values.size() * sizeof(T));
+  }
+
+  void Write(const std::wstring& str) {
+    Write(static_cast<uint32_t>(str.size()));
+    data_.append(reinterpret_cast<const char*>(str.data()),
+                 str.size() * sizeof(wchar_t));
+  }
+
+  // Writes data that was serialized beforehand, prefixed with its size
+  void WriteSection(const std::string& data) {
+    Write(static_cast<uint64_t>(data.size()));
+    data_.append(data);
+  }
+
+  std::string& data() { return data_; }
+
+private:
+  std::string data_;
+};
+
+// Reads values from a snapshot, failing if there's not enough data left
+class SnapshotReader {
+public:
+  SnapshotReader(const char* data, size_t size)
+      : data_{data}, end_{data + size} {}
+
+  template <typename T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (remaining() < sizeof(T))
+      return false;
+    std::memcpy(&value, data_, sizeof(T));
+    data_ += sizeof(T);
+    return true;
+  }
+
+  template <typename T>
+  bool Read(std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint32_t size = 0;
+    if (!Read(size) || remaining() / sizeof(T) < size)
+      return false;
+    values.resize(size);
+    std::memcpy(values.data(), data_, size * sizeof(T));
+    data_ += size * sizeof(T);
+    return true;
+  }
+
+  bool Read(std::wstring& str) {
+    uint32_t size = 0;
+    if (!Read(size) || remaining() / sizeof(wchar_t) < size)
+      return false;
+    str.resize(size);
+    std::memcpy(str.data(), data_, size * sizeof(wchar_t));
+    data_ += size * sizeof(wchar_t);
+    return true;
+  }
+
+  // Returns a reader for the next section, and skips over it
+  bool ReadSection(SnapshotReader& section) {
+    uint64_t size = 0;
+    if (!Read(size) || remaining() < size)
+      return false;
+    section = SnapshotReader{data_, static_cast<size_t>(size)};
+    data_ += size;
+    return true;
+  }
+
+  const char* data() const { return data_; }
+  size_t remaining() const { return static_cast<size_t>(end_ - data_); }
+
+private:
+  const char* data_;
+  const char* end_;
+};
+
+}  // namespace track::recognition
@@ -0,0 +1,198 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "track/recognition_titles.h"
+
+namespace track::recognition {
+
+std::optional<TitleDictionary::IdList> TitleDictionary::Find(
+    std::wstring_view title) const {
+  if (slots_.empty())
+    return std::nullopt;
+
+  const auto slot = slots_[FindSlot(title, Hash(title))];
+  if (!slot)
+    return std::nullopt;
+
+  return GetIds(entries_[slot - 1]);
+}
+
+void TitleDictionary::Insert(std::wstring_view title, int id) {
+  // Keep the load factor below 70%
+  if ((entries_.size() + 1) * 10 > slots_.size() * 7)
+    Rehash(std::max<size_t>(slots_.size() * 2, 64));
+
+  const auto hash = Hash(title);
+  auto& slot = slots_[FindSlot(title, hash)];
+
+  if (!slot) {
+    Entry entry;
+    entry.offset = static_cast<uint32_t>(buffer_.size());
+    entry.length = static_cast<uint32_t>(title.size());
+    entry.hash = hash;
+    buffer_.append(title);
+    entries_.push_back(entry);
+    slot = static_cast<uint32_t>(entries_.size());
+  }
+
+  if (InsertId(entries_[slot - 1], id))
+    id_entries_[id].push_back(slot - 1);
+}
+
+void TitleDictionary::Erase(int id) {
+  const auto it = id_entries_.find(id);
+  if (it == id_entries_.end())
+    return;
+
+  for (const auto index : it->second) {
+    EraseId(entries_[index], id);
+  }
+
+  id_entries_.erase(it);
+}
+
+void TitleDictionary::Clear() {
+  buffer_.clear();
+  entries_.clear();
+  slots_.clear();
+  overflow_.clear();
+  free_overflow_.clear();
+  id_entries_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t TitleDictionary::Hash(std::wstring_view title) {
+  // FNV-1a
+  uint32_t hash = 2166136261;
+  for (const auto c : title) {
+    hash ^= static_cast<uint32_t>(c);
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+size_t TitleDictionary::FindSlot(std::wstring_view title,
+                                 uint32_t hash) const {
+  const size_t mask = slots_.size() - 1;
+
+  // Linear probing, as the table is never more than 70% full
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const auto slot = slots_[i];
+    if (!slot)
+      return i;
+    const auto& entry = entries_[slot - 1];
+    if (entry.hash == hash && GetTitle(entry) == title)
+      return i;
+  }
+}
+
+void TitleDictionary::Rehash(size_t slot_count) {
+  slots_.assign(slot_count, 0);
+
+  const size_t mask = slot_count - 1;
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    size_t j = entries_[i].hash & mask;
+    while (slots_[j])
+      j = (j + 1) & mask;
+    slots_[j] = static_cast<uint32_t>(i + 1);
+  }
+}
+
+std::wstring_view TitleDictionary::GetTitle(const Entry& entry) const {
+  return std::wstring_view{buffer_.data() + entry.offset, entry.length};
+}
+
+TitleDictionary::IdList TitleDictionary::GetIds(const Entry& entry) const {
+  if (entry.id_count > kInlineIds) {
+    const auto& ids = overflow_[entry.ids[0]];
+    return IdList{ids.data(), ids.data() + ids.size()};
+  }
+  return IdList{entry.ids.data(), entry.ids.data() + entry.id_count};
+}
+
+bool TitleDictionary::InsertId(Entry& entry, int id) {
+  // IDs are kept sorted and unique
+  if (entry.id_count < kInlineIds) {
+    const auto first = entry.ids.begin();
+    const auto last = first + entry.id_count;
+    const auto it = std::lower_bound(first, last, id);
+    if (it != last && *it == id)
+      return false;
+    std::copy_backward(it, last, last + 1);
+    *it = id;
+
+  } else if (entry.id_count == kInlineIds) {
+    if (std::binary_search(entry.ids.begin(), entry.ids.end(), id))
+      return false;
+    std::vector<int> ids{entry.ids.begin(), entry.ids.end()};
+    ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    // Lists that were emptied by EraseId are reused first
+    if (!free_overflow_.empty()) {
+      entry.ids[0] = static_cast<int>(free_overflow_.back());
+      free_overflow_.pop_back();
+      overflow_[entry.ids[0]] = std::move(ids);
+    } else {
+      entry.ids[0] = static_cast<int>(overflow_.size());
+      overflow_.push_back(std::move(ids));
+    }
+
+  } else {
+    auto& ids = overflow_[entry.ids[0]];
+    const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    if (it != ids.end() && *it == id)
+      return false;
+    ids.insert(it, id);
+  }
+
+  ++entry.id_count;
+  return true;
+}
+
+void TitleDictionary::EraseId(Entry& entry, int id) {
+  if (entry.id_count > kInlineIds) {
+    auto& ids = overflow_[entry.ids[0]];
+    const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id)
+      return;
+    ids.erase(it);
+    if (ids.size() == kInlineIds) {
+      // The overflow list is left empty for the next entry that needs one, as
+      // the indexes of the others must not change
+      const auto index = static_cast<uint32_t>(entry.ids[0]);
+      std::copy(ids.begin(), ids.end(), entry.ids.begin());
+      std::vector<int>{}.swap(ids);
+      free_overflow_.push_back(index);
+    }
+
+  } else {
+    const auto first = entry.ids.begin();
+    const auto last = first + entry.id_count;
+    const auto it = std::lower_bound(first, last, id);
+    if (it == last || *it != id)
+      return;
+    std::copy(it + 1, last, it);
+  }
+
+  --entry.id_count;
+}
+
+}  // namespace track::recognition
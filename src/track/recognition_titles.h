@@ -0,0 +1,97 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace track::recognition {
+
+// A compact map of titles to anime IDs. Titles are stored back to back in a
+// single buffer and found through an open-addressing hash table. Most titles
+// belong to a single anime, so a couple of IDs are kept inline, and longer
+// lists are moved to separate storage. The entries of each ID are also kept,
+// so that erasing an ID doesn't require going through the whole dictionary.
+class TitleDictionary {
+public:
+  class IdList {
+  public:
+    IdList(const int* first, const int* last) : first_{first}, last_{last} {}
+
+    const int* begin() const { return first_; }
+    const int* end() const { return last_; }
+    bool empty() const { return first_ == last_; }
+    size_t size() const { return last_ - first_; }
+
+  private:
+    const int* first_;
+    const int* last_;
+  };
+
+  // Returns nothing if the title was never inserted. A title remains in the
+  // dictionary with an empty list after all of its IDs are erased.
+  std::optional<IdList> Find(std::wstring_view title) const;
+
+  void Insert(std::wstring_view title, int id);
+  void Erase(int id);
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  // Number of lists that hold the IDs of titles with more than a few, which
+  // includes the ones that are free to be reused
+  size_t overflow_size() const { return overflow_.size(); }
+
+private:
+  static constexpr size_t kInlineIds = 2;
+
+  struct Entry {
+    uint32_t offset = 0;  // position of the title in the buffer
+    uint32_t length = 0;
+    uint32_t hash = 0;
+    uint32_t id_count = 0;
+    // If there are more IDs than can be kept inline, the first element holds
+    // the index of the overflow list instead
+    std::array<int, kInlineIds> ids{};
+  };
+
+  static uint32_t Hash(std::wstring_view title);
+
+  size_t FindSlot(std::wstring_view title, uint32_t hash) const;
+  void Rehash(size_t slot_count);
+
+  std::wstring_view GetTitle(const Entry& entry) const;
+  IdList GetIds(const Entry& entry) const;
+
+  bool InsertId(Entry& entry, int id);
+  void EraseId(Entry& entry, int id);
+
+  std::wstring buffer_;
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> slots_;  // entry index + 1, or 0 if the slot is empty
+  std::vector<std::vector<int>> overflow_;
+  std::vector<uint32_t> free_overflow_;  // indexes of empty overflow lists
+  std::unordered_map<int, std::vector<uint32_t>> id_entries_;
+};
+
+}  // namespace track::recognition
@@ -0,0 +1,111 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <cstdlib>
+
+#include <utf8proc/utf8proc.h>
+
+#include "track/recognition_unicode.h"
+
+#include "base/string.h"
+
+namespace track::recognition {
+
+// Most titles are pure ASCII. The loop has no early exit, so that it can be
+// vectorized.
+static bool IsAsciiString(const std::wstring& str) {
+  unsigned int mask = 0;
+  for (const auto c : str) {
+    mask |= static_cast<unsigned int>(c);
+  }
+  return mask < 0x80;
+}
+
+// Equivalent of the options of MapUnicode for ASCII characters. Letters are
+// case folded, new lines and tabs are converted to spaces, and other control
+// characters are stripped (marked as null). NFKC normalization, lumping and
+// ignorable characters do not affect ASCII.
+static constexpr std::array<wchar_t, 0x80> kAsciiNormalizationTable = [] {
+  std::array<wchar_t, 0x80> table{};
+  for (wchar_t c = 0x20; c < 0x7F; ++c) {
+    table[c] = (c >= L'A' && c <= L'Z') ? c + (L'a' - L'A') : c;
+  }
+  for (const auto c : {L'\t', L'\n', L'\v', L'\f', L'\r'}) {
+    table[c] = L' ';
+  }
+  return table;
+}();
+
+static void NormalizeAscii(std::wstring& str) {
+  // Conversion to UTF-8 stops at the first null character
+  const auto null_pos = str.find(L'\0');
+  if (null_pos != str.npos)
+    str.resize(null_pos);
+
+  size_t length = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    const wchar_t c = kAsciiNormalizationTable[str[i]];
+    if (!c)
+      continue;
+    // CR LF is a single new line
+    if (str[i] == L'\r' && i + 1 < str.size() && str[i + 1] == L'\n')
+      ++i;
+    str[length++] = c;
+  }
+  str.resize(length);
+}
+
+void NormalizeUnicode(std::wstring& str) {
+  if (IsAsciiString(str)) {
+    NormalizeAscii(str);
+  } else {
+    MapUnicode(str);
+  }
+}
+
+void MapUnicode(std::wstring& str) {
+  constexpr int options =
+      // NFKC normalization according to Unicode Standard Annex #15
+      UTF8PROC_COMPAT | UTF8PROC_COMPOSE | UTF8PROC_STABLE |
+      // Strip "default ignorable" characters, control characters, character
+      // marks (accents, diaeresis)
+      UTF8PROC_IGNORE | UTF8PROC_STRIPCC | UTF8PROC_STRIPMARK |
+      // Map certain characters (e.g. hyphen and minus) for easier comparison
+      UTF8PROC_LUMP |
+      // Perform unicode case folding for case-insensitive comparison
+      UTF8PROC_CASEFOLD;
+
+  char* buffer = nullptr;
+  std::string temp = WstrToStr(str);
+
+  const auto length = utf8proc_map(
+      reinterpret_cast<const utf8proc_uint8_t*>(temp.data()), temp.length(),
+      reinterpret_cast<utf8proc_uint8_t**>(&buffer),
+      static_cast<utf8proc_option_t>(options));
+
+  if (length >= 0) {
+    temp.assign(buffer, length);
+    str = StrToWstr(temp);
+  }
+
+  if (buffer)
+    free(buffer);
+}
+
+}  // namespace track::recognition
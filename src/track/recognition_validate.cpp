@@ -29,6 +29,7 @@
 #include "media/anime_util.h"
 #include "track/episode.h"
 #include "track/episode_util.h"
+#include "track/recognition_counters.h"
 
 namespace track::recognition {
 
@@ -47,6 +48,8 @@ bool Engine::ValidateOptions(anime::Episode& episode,
                              const anime::Item& anime_item,
                              const MatchOptions& match_options,
                              bool redirect) const {
+  RECOGNITION_COUNT(ValidateOptions);
+
   if (match_options.check_airing_date)
     if (anime_item.GetDateStart() && !anime::IsAiredYet(anime_item))
       return false;
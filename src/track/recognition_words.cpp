@@ -0,0 +1,268 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cwctype>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "track/recognition_words.h"
+
+#include "base/string.h"
+
+namespace track::recognition {
+
+// Same as the boundary check of ReplaceString for whole words
+static bool IsWordBoundary(const wchar_t c) {
+  // Equivalent to the checks below for ASCII, without the function calls
+  if (c < 0x80) {
+    return (c >= 0x09 && c <= 0x0D) || (c >= 0x20 && c <= 0x2F) ||
+           (c >= 0x3A && c <= 0x40) || (c >= 0x5B && c <= 0x60) ||
+           (c >= 0x7B && c <= 0x7E);
+  }
+  return iswspace(c) || iswpunct(c);
+}
+
+class WordTable {
+public:
+  using value_t = std::pair<std::wstring_view, std::wstring_view>;
+
+  WordTable(std::initializer_list<value_t> words) : words_{words} {
+    for (const auto& [word, replacement] : words_) {
+      max_length_ = std::max(max_length_, word.size());
+    }
+  }
+
+  const std::wstring_view* Find(const std::wstring_view word) const {
+    if (word.size() <= max_length_) {
+      for (const auto& [key, replacement] : words_) {
+        if (key == word)
+          return &replacement;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  std::vector<value_t> words_;
+  size_t max_length_ = 0;
+};
+
+// Replaces whole words that are found in the table in a single pass. For
+// patterns that consist of a single word, this gives the same result as
+// calling ReplaceString for each of them.
+static void ReplaceWords(const std::wstring& input, std::wstring& output,
+                         const WordTable& table) {
+  output.clear();
+
+  size_t copied = 0;
+
+  for (size_t i = 0; i < input.size(); ) {
+    if (IsWordBoundary(input[i])) {
+      ++i;
+      continue;
+    }
+    size_t j = i;
+    while (j < input.size() && !IsWordBoundary(input[j]))
+      ++j;
+    const auto replacement =
+        table.Find(std::wstring_view{input.data() + i, j - i});
+    if (replacement) {
+      output.append(input, copied, i - copied);
+      output.append(*replacement);
+      copied = j;
+    }
+    i = j;
+  }
+
+  output.append(input, copied, std::wstring::npos);
+}
+
+// Replaces whole-word occurrences of several patterns, which may span more
+// than one word. A trie of all patterns finds the rules that occur in the
+// string in a single pass, and only those rules are applied, in their order.
+// A replacement can form the pattern of a later rule (e.g. "season 2nd season"
+// -> "season 2"), so the string is scanned again after each replacement. This
+// gives the same result as calling ReplaceString for every rule in turn.
+class WordReplacer {
+public:
+  using rule_t = std::pair<std::wstring, std::wstring>;
+
+  explicit WordReplacer(const std::vector<rule_t>& rules) : rules_{rules} {
+    assert(rules_.size() <= 64);
+    root_children_.fill(kNone);
+    nodes_.emplace_back();
+    for (size_t rule = 0; rule < rules_.size(); ++rule) {
+      size_t node = 0;
+      for (const auto c : rules_[rule].first) {
+        node = AddChild(node, c);
+      }
+      nodes_[node].rules |= uint64_t{1} << rule;
+    }
+  }
+
+  // Returns true if the string was modified
+  bool Replace(std::wstring& str) const {
+    bool replaced = false;
+
+    uint64_t pending = FindRules(str);
+
+    for (size_t rule = 0; pending && rule < rules_.size(); ++rule) {
+      const uint64_t bit = uint64_t{1} << rule;
+      if (!(pending & bit))
+        continue;
+      pending &= ~bit;
+      const auto& [pattern, replacement] = rules_[rule];
+      if (ReplaceString(str, 0, pattern, replacement, true, true)) {
+        replaced = true;
+        // Rules up to this one have already been applied
+        pending |= FindRules(str) & ~(bit | (bit - 1));
+      }
+    }
+
+    return replaced;
+  }
+
+private:
+  static constexpr size_t kNone = static_cast<size_t>(-1);
+
+  struct Node {
+    std::vector<std::pair<wchar_t, size_t>> children;
+    uint64_t rules = 0;
+  };
+
+  // Returns the rules whose patterns occur in the string, regardless of word
+  // boundaries
+  uint64_t FindRules(const std::wstring& str) const {
+    uint64_t rules = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+      size_t node = 0;
+      for (size_t j = i; j < str.size(); ++j) {
+        node = FindChild(node, str[j]);
+        if (node == kNone)
+          break;
+        rules |= nodes_[node].rules;
+      }
+    }
+    return rules;
+  }
+
+  size_t AddChild(size_t node, wchar_t c) {
+    const auto child = FindChild(node, c);
+    if (child != kNone)
+      return child;
+    nodes_.emplace_back();
+    nodes_[node].children.emplace_back(c, nodes_.size() - 1);
+    if (node == 0 && static_cast<size_t>(c) < root_children_.size())
+      root_children_[c] = nodes_.size() - 1;
+    return nodes_.size() - 1;
+  }
+
+  size_t FindChild(size_t node, wchar_t c) const {
+    // Most positions don't start a pattern, so the first step is a table
+    // lookup for ASCII characters.
+    if (node == 0 && static_cast<size_t>(c) < root_children_.size())
+      return root_children_[c];
+    for (const auto& [key, child] : nodes_[node].children) {
+      if (key == c)
+        return child;
+    }
+    return kNone;
+  }
+
+  std::vector<Node> nodes_;
+  std::array<size_t, 0x80> root_children_;
+  std::vector<rule_t> rules_;
+};
+
+void ConvertRomanNumbersAndTransliterate(std::wstring& str) {
+  // We skip 1 and 10 to avoid matching "I" and "X", as they're unlikely to be
+  // used as Roman numerals. Any number above "XIII" is rarely used in anime
+  // titles, which is why we don't need an actual Roman-to-Arabic number
+  // conversion algorithm.
+  static const WordTable numerals{
+    {L"II", L"2"}, {L"III", L"3"}, {L"IV", L"4"}, {L"V", L"5"},
+    {L"VI", L"6"}, {L"VII", L"7"}, {L"VIII", L"8"}, {L"IX", L"9"},
+    {L"XI", L"11"}, {L"XII", L"12"}, {L"XIII", L"13"},
+  };
+
+  // Romanizations (Hepburn to Wapuro)
+  static const WordTable romanizations{
+    {L"wa", L"ha"}, {L"e", L"he"}, {L"o", L"wo"},
+  };
+
+  // Roman numerals are matched before transliteration, and romanizations
+  // after, as transliteration can change word boundaries (e.g. "@").
+  thread_local std::wstring buffer;
+  ReplaceWords(str, buffer, numerals);
+
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    switch (buffer[i]) {
+      // Character equivalencies that are not included in UTF8PROC_LUMP
+      case L'@': buffer[i] = L'a'; break;  // e.g. "iDOLM@STER" (doesn't make a difference for "GJ-bu@" or "Sasami-san@Ganbaranai")
+      case L'\u00D7': buffer[i] = L'x'; break;  // multiplication sign (e.g. "Tasogare Otome x Amnesia")
+      case L'\uA789': buffer[i] = L':'; break;  // modifier letter colon (e.g. "Nisekoi:")
+      // A few common always-equivalent romanizations
+      case L'\u014C': buffer.replace(i, 1, L"ou"); break;  // latin capital letter o with macron
+      case L'\u014D': buffer.replace(i, 1, L"ou"); break;  // latin small letter o with macron
+      case L'\u016B': buffer.replace(i, 1, L"uu"); break;  // latin small letter u with macron
+    }
+  }
+
+  ReplaceWords(buffer, str, romanizations);
+}
+
+void ConvertNumbersAndEraseUnnecessary(std::wstring& str) {
+  static const WordTable ordinals{
+    {L"first", L"1st"}, {L"second", L"2nd"}, {L"third", L"3rd"},
+    {L"fourth", L"4th"}, {L"fifth", L"5th"}, {L"sixth", L"6th"},
+    {L"seventh", L"7th"}, {L"eighth", L"8th"}, {L"ninth", L"9th"},
+  };
+
+  // Season numbers, followed by the rest of the unnecessary words. This works
+  // considerably faster than regular expressions.
+  static const WordReplacer replacer{{
+    {L"1st season", L"1"}, {L"season 1", L"1"}, {L"series 1", L"1"}, {L"s1", L"1"},
+    {L"2nd season", L"2"}, {L"season 2", L"2"}, {L"series 2", L"2"}, {L"s2", L"2"},
+    {L"3rd season", L"3"}, {L"season 3", L"3"}, {L"series 3", L"3"}, {L"s3", L"3"},
+    {L"4th season", L"4"}, {L"season 4", L"4"}, {L"series 4", L"4"}, {L"s4", L"4"},
+    {L"5th season", L"5"}, {L"season 5", L"5"}, {L"series 5", L"5"}, {L"s5", L"5"},
+    {L"6th season", L"6"}, {L"season 6", L"6"}, {L"series 6", L"6"}, {L"s6", L"6"},
+    {L"&", L"and"},
+    {L"the animation", L""},
+    {L"the", L""},
+    {L"episode", L""},
+    {L"oad", L"ova"},
+    {L"oav", L"ova"},
+    {L"specials", L"sp"},
+    {L"special", L"sp"},
+    {L"(tv)", L""},
+  }};
+
+  // Ordinal numbers are converted first, so that they can be matched by
+  // season numbers (e.g. "first season" -> "1st season" -> "1").
+  thread_local std::wstring buffer;
+  ReplaceWords(str, buffer, ordinals);
+  str.swap(buffer);
+  replacer.Replace(str);
+}
+
+}  // namespace track::recognition
@@ -0,0 +1,31 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+namespace track::recognition {
+
+// Stages of title normalization that replace whole words. They are applied
+// before and after Unicode normalization, respectively, and the second one
+// expects lower case text.
+void ConvertRomanNumbersAndTransliterate(std::wstring& str);
+void ConvertNumbersAndEraseUnnecessary(std::wstring& str);
+
+}  // namespace track::recognition
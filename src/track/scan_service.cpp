@@ -0,0 +1,536 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <map>
+
+#include "track/scan_service.h"
+
+#include "base/file.h"
+#include "base/format.h"
+#include "base/log.h"
+#include "base/string.h"
+#include "media/anime_db.h"
+#include "media/anime_util.h"
+#include "taiga/settings.h"
+#include "track/recognition.h"
+#include "track/scanner.h"
+#include "ui/ui.h"
+
+namespace track {
+
+// Reading directories is mostly waiting on the disk or the network, so this
+// doesn't depend on the number of processors
+constexpr size_t kScanThreadCount = 8;
+
+// Results are applied to the database in batches of this size, and the
+// background thread waits when too many of them are yet to be applied
+constexpr size_t kBatchSize = 256;
+constexpr size_t kMaxBatches = 64;
+
+bool ScanRequest::operator==(const ScanRequest& request) const {
+  // Requests that only differ in being silent are for the same scan
+  return anime_id == request.anime_id &&
+         episode_number == request.episode_number &&
+         quick == request.quick;
+}
+
+// Folders are compared without regard to case, as they are on Windows
+static std::wstring GetFolderKey(const std::wstring& folder) {
+  return ToLower_Copy(AddTrailingSlash(folder));
+}
+
+// Returns the number of directories under the folder, including itself, given
+// the sorted keys of all directories
+static size_t CountDirectories(const std::wstring& folder_key,
+                               const std::vector<std::wstring>& keys) {
+  // Keys end with a backslash, so every key that starts with the folder's key
+  // sorts before the same key that ends with the next character instead
+  auto end_key = folder_key;
+  ++end_key.back();
+  const auto first = std::lower_bound(keys.begin(), keys.end(), folder_key);
+  const auto last = std::lower_bound(first, keys.end(), end_key);
+  return static_cast<size_t>(std::distance(first, last));
+}
+
+static void StartProgress() {
+  ui::taskbar_list.SetProgressState(TBPF_INDETERMINATE);
+  ui::ChangeStatusText(L"Scanning available episodes...");
+}
+
+static void EndProgress() {
+  ui::taskbar_list.SetProgressState(TBPF_NOPROGRESS);
+  ui::ClearStatusText();
+}
+
+ScanService::~ScanService() {
+  Stop();
+}
+
+void ScanService::Request(ScanRequest request) {
+  // Results can only be dispatched through the window
+  if (!window_handle_) {
+    std::wstring path_found;
+    Run(request, path_found);
+    return;
+  }
+
+  if (running_ && *running_ == request) {
+    if (running_->silent && !request.silent) {
+      running_->silent = false;
+      StartProgress();
+    }
+    return;
+  }
+  for (auto& queued_request : requests_) {
+    if (queued_request == request) {
+      queued_request.silent = queued_request.silent && request.silent;
+      return;
+    }
+  }
+
+  if (request.silent) {
+    requests_.push_back(request);
+  } else {
+    // The interrupted scan starts over after this one, although the files it
+    // has already identified are read from the index
+    if (running_) {
+      const auto interrupted_request = *running_;
+      Stop();
+      Finish(nullptr);
+      requests_.push_front(interrupted_request);
+    }
+    requests_.push_front(request);
+  }
+
+  if (!running_)
+    StartNext();
+}
+
+bool ScanService::Run(const ScanRequest& request, std::wstring& path_found) {
+  std::optional<ScanRequest> interrupted_request = running_;
+  if (running_) {
+    Stop();
+    Finish(nullptr);
+  }
+
+  bool found = false;
+  Plan plan;
+
+  if (BuildPlan(request, plan)) {
+    if (!request.silent) {
+      StartProgress();
+      ui::SetSharedCursor(IDC_WAIT);
+    }
+
+    Prepare(request);
+    scanner.set_path_found(L"");
+    running_ = request;
+    plan_ = plan;
+    directories_.clear();
+
+    for (const auto& [anime_id, folder] : plan_.folders) {
+      if (const auto anime_item = anime::db.Find(anime_id))
+        anime::ValidateFolder(*anime_item);
+    }
+
+    std::vector<std::wstring> scanned_folders;
+    for (const auto& step : plan_.steps) {
+      if (!FolderExists(step.root))
+        continue;  // Might be a disconnected external drive
+      scanned_folders.push_back(step.root);
+      if (step.identify_directories) {
+        scanner.options = step.options;
+        found = scanner.Search(step.root);
+      } else {
+        std::vector<base::FileSearchResult> results;
+        base::FileSearch file_search;
+        file_search.options = step.options;
+        const auto on_result = [&results](const base::FileSearchResult& result) {
+          results.push_back(result);
+          return false;
+        };
+        file_search.Search(step.root, on_result, on_result);
+        found = Apply(step, results);
+      }
+      if (found)
+        break;
+    }
+
+    // The scanner is shared with the scans that are resumed or started after
+    // this one, so the path is copied before anything else can run
+    if (found)
+      path_found = scanner.path_found();
+
+    if (!request.silent)
+      ui::SetSharedCursor(IDC_ARROW);
+    Finish(found ? nullptr : &scanned_folders);
+  }
+
+  if (interrupted_request) {
+    requests_.push_front(*interrupted_request);
+    StartNext();
+  }
+
+  return found;
+}
+
+void ScanService::Shutdown() {
+  requests_.clear();
+
+  if (running_) {
+    Stop();
+    scanner.index().Save();
+    running_.reset();
+  }
+}
+
+void ScanService::Dispatch() {
+  std::deque<Batch> batches;
+  {
+    std::lock_guard lock{mutex_};
+    batches.swap(batches_);
+  }
+  batch_taken_.notify_one();
+
+  for (auto& batch : batches) {
+    // Results of an interrupted scan are discarded
+    if (!running_ || batch.scan_id != scan_id_)
+      continue;
+
+    // Anime folders that no longer exist are cleared before any of the
+    // results, which might assign new folders. Folders that were changed
+    // since they were checked are left alone.
+    for (const auto& [anime_id, folder] : batch.missing_folders) {
+      const auto anime_item = anime::db.Find(anime_id);
+      if (!anime_item || anime_item->GetFolder() != folder)
+        continue;
+      LOGD(L"Folder doesn't exist anymore.\nPath: {}", folder);
+      anime_item->SetFolder(L"");
+      for (int i = 1; i <= anime_item->GetAvailableEpisodeCount(); ++i) {
+        anime_item->SetEpisodeAvailability(i, false, L"");
+      }
+    }
+
+    if (!batch.results.empty() &&
+        Apply(plan_.steps.at(batch.step), batch.results)) {
+      // There's no need to read any more folders once the anime or the
+      // episode is found
+      Stop();
+      Finish(nullptr);
+    } else if (batch.finished) {
+      thread_.join();
+      Finish(&batch.scanned_folders);
+    }
+  }
+
+  if (running_ && !running_->silent) {
+    ui::ChangeStatusText(L"Scanning available episodes... ({} files)"_format(
+        file_count_));
+  }
+
+  if (!running_)
+    StartNext();
+}
+
+bool ScanService::busy() const {
+  return running_.has_value();
+}
+
+void ScanService::SetWindowHandle(HWND hwnd) {
+  window_handle_ = hwnd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ScanService::BuildPlan(const ScanRequest& request, Plan& plan) const {
+  base::FileSearchOptions options;
+  options.min_file_size = taiga::settings.GetLibraryFileSizeThreshold();
+  options.thread_count = kScanThreadCount;
+
+  const auto add_step = [&](const std::wstring& root, bool skip_directories,
+                            bool skip_subdirectories) {
+    Step step;
+    step.root = root;
+    step.options = options;
+    step.options.skip_directories = skip_directories;
+    step.options.skip_subdirectories = skip_subdirectories;
+    plan.steps.push_back(step);
+  };
+
+  if (request.quick) {
+    if (!anime::IsValidId(request.anime_id)) {
+      // Each directory that contains an anime folder is walked only once, no
+      // matter how many anime folders it's a part of. Files are matched to
+      // anime through identification, rather than through the folder that
+      // they are found in.
+      std::map<std::wstring, std::wstring> roots;  // key -> folder
+      for (const auto& [id, anime_item] : anime::db.items) {
+        const auto& folder = anime_item.GetFolder();
+        if (folder.empty())
+          continue;
+        plan.anime_folders.push_back(GetFolderKey(folder));
+        roots.emplace(plan.anime_folders.back(), folder);
+      }
+      // Nested folders are walked as a part of the folder that contains them
+      for (auto it = roots.begin(); it != roots.end(); ) {
+        const auto& root_key = it->first;
+        auto next = std::next(it);
+        while (next != roots.end() && StartsWith(next->first, root_key)) {
+          next = roots.erase(next);
+        }
+        it = next;
+      }
+      for (const auto& [root_key, root] : roots) {
+        add_step(root, false, false);
+        plan.steps.back().identify_directories = false;
+      }
+
+    } else if (const auto anime_item = anime::db.Find(request.anime_id)) {
+      // A single anime can end the search as soon as all of its episodes are
+      // available
+      if (!anime_item->GetFolder().empty())
+        add_step(anime_item->GetFolder(), true, false);
+    }
+
+    return true;
+  }
+
+  const auto library_folders = taiga::settings.GetLibraryFolders();
+
+  // Check if any library folder is available
+  if (!request.silent && library_folders.empty()) {
+    ui::OnSettingsLibraryFoldersEmpty();
+    return false;
+  }
+
+  const auto anime_item = anime::db.Find(request.anime_id);
+
+  if (anime_item) {
+    // Check if the anime folder still exists
+    anime::ValidateFolder(*anime_item);
+
+    // Search the anime folder for available episodes
+    if (!anime_item->GetFolder().empty())
+      add_step(anime_item->GetFolder(), true, false);
+
+    // Search the cached episode path
+    if (!anime_item->GetNextEpisodePath().empty()) {
+      const auto next_episode_path =
+          GetPathOnly(anime_item->GetNextEpisodePath());
+      if (!IsEqual(next_episode_path, anime_item->GetFolder()))
+        add_step(next_episode_path, true, true);
+    }
+
+  } else {
+    // Anime folders are checked in the background as well, since they might
+    // be on a slow or disconnected drive
+    for (const auto& [id, item] : anime::db.items) {
+      if (!item.GetFolder().empty())
+        plan.folders.emplace_back(id, item.GetFolder());
+    }
+    plan.prune = true;
+  }
+
+  // Search library folders for available episodes
+  const bool skip_directories =
+      anime_item && !anime_item->GetFolder().empty();
+  for (const auto& folder : library_folders) {
+    add_step(folder, skip_directories, false);
+  }
+
+  return true;
+}
+
+void ScanService::Prepare(const ScanRequest& request) const {
+  scanner.index().Load(Meow.GetRecognitionStamp());
+
+  scanner.set_anime_id(request.anime_id);
+  scanner.set_episode_number(request.episode_number);
+}
+
+bool ScanService::Apply(const Step& step,
+                        const std::vector<base::FileSearchResult>& results) {
+  // Results are recognized here rather than in the background thread, as
+  // identification reads the database
+  std::vector<ScanEntry> entries;
+  scanner.Identify(results, step.identify_directories, entries);
+
+  // Directories that were not identified are only counted
+  for (const auto& entry : entries) {
+    if (!entry.is_directory) {
+      ++file_count_;
+    } else if (!step.identify_directories) {
+      directories_.push_back(entry.path);
+    }
+  }
+
+  // Directories are identified differently when files are to be skipped
+  scanner.options = step.options;
+  return scanner.OnEntries(entries);
+}
+
+void ScanService::StartNext() {
+  while (!running_ && !requests_.empty()) {
+    const auto request = requests_.front();
+    requests_.pop_front();
+
+    Plan plan;
+    if (!BuildPlan(request, plan))
+      continue;
+
+    Prepare(request);
+    running_ = request;
+    plan_ = plan;
+    ++scan_id_;
+    file_count_ = 0;
+    directories_.clear();
+
+    if (!request.silent)
+      StartProgress();
+
+    cancelled_ = false;
+    thread_ = std::thread(&ScanService::Work, this, scan_id_, std::move(plan));
+  }
+}
+
+void ScanService::Stop() {
+  {
+    std::lock_guard lock{mutex_};
+    cancelled_ = true;
+  }
+  batch_taken_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+
+  std::lock_guard lock{mutex_};
+  batches_.clear();
+}
+
+void ScanService::Finish(const std::vector<std::wstring>* scanned_folders) {
+  // Every file in the folders was visited, unless the search ended early
+  if (scanned_folders) {
+    if (plan_.prune)
+      scanner.index().Prune(*scanned_folders);
+
+    if (!plan_.anime_folders.empty()) {
+      // Count the visits that walking each anime folder separately would take
+      std::vector<std::wstring> directory_keys;
+      for (const auto& folder : *scanned_folders) {
+        directory_keys.push_back(GetFolderKey(folder));
+      }
+      for (const auto& directory : directories_) {
+        directory_keys.push_back(GetFolderKey(directory));
+      }
+      std::sort(directory_keys.begin(), directory_keys.end());
+
+      size_t separate_visits = 0;
+      for (const auto& folder_key : plan_.anime_folders) {
+        separate_visits += CountDirectories(folder_key, directory_keys);
+      }
+
+      LOGD(L"Scanned {} anime folders in {} roots. Visited {} directories, "
+           L"saving {} visits.",
+           plan_.anime_folders.size(), plan_.steps.size(),
+           directory_keys.size(),
+           separate_visits - std::min(separate_visits, directory_keys.size()));
+    }
+  }
+
+  scanner.index().Save();
+
+  if (!running_->silent)
+    EndProgress();
+
+  running_.reset();
+  plan_ = Plan{};
+
+  ui::OnScanAvailableEpisodesFinished();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ScanService::Work(const unsigned int scan_id, const Plan plan) {
+  Batch batch;
+  batch.scan_id = scan_id;
+
+  for (const auto& [anime_id, folder] : plan.folders) {
+    if (cancelled_)
+      return;
+    if (!FolderExists(folder))
+      batch.missing_folders.emplace_back(anime_id, folder);
+  }
+
+  std::vector<std::wstring> scanned_folders;
+
+  for (size_t i = 0; i < plan.steps.size(); ++i) {
+    if (cancelled_)
+      return;
+
+    const auto& step = plan.steps[i];
+    if (!FolderExists(step.root))
+      continue;  // Might be a disconnected external drive
+    scanned_folders.push_back(step.root);
+
+    batch.step = i;
+
+    const auto on_result = [&](const base::FileSearchResult& result) {
+      batch.results.push_back(result);
+      if (batch.results.size() >= kBatchSize)
+        Post(batch);
+      return cancelled_.load();
+    };
+
+    base::FileSearch file_search;
+    file_search.options = step.options;
+    file_search.Search(step.root, on_result, on_result);
+
+    // Results are never mixed between steps
+    if (!batch.results.empty())
+      Post(batch);
+  }
+
+  if (cancelled_)
+    return;
+
+  batch.scanned_folders = std::move(scanned_folders);
+  batch.finished = true;
+  Post(batch);
+}
+
+void ScanService::Post(Batch& batch) {
+  {
+    std::unique_lock lock{mutex_};
+    batch_taken_.wait(lock, [this]() {
+      return cancelled_ || batches_.size() < kMaxBatches;
+    });
+    if (cancelled_)
+      return;
+
+    Batch next_batch;
+    next_batch.scan_id = batch.scan_id;
+    next_batch.step = batch.step;
+    batches_.push_back(std::move(batch));
+    batch = std::move(next_batch);
+  }
+
+  ::PostMessage(window_handle_, WM_TAIGA_SCANCALLBACK, 0, 0);
+}
+
+}  // namespace track
@@ -0,0 +1,132 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base/file_search.h"
+#include "media/anime.h"
+#include "track/scanner.h"
+
+constexpr unsigned int WM_TAIGA_SCANCALLBACK = WM_APP + 0x33;
+
+namespace track {
+
+struct ScanRequest {
+  // Scans for all anime when the ID is unknown, or for a single anime
+  // otherwise. A single anime scan ends as soon as the episode is found, or
+  // when all episodes are available if the episode number is 0.
+  int anime_id = anime::ID_UNKNOWN;
+  int episode_number = 0;
+  // Quick scans only walk anime folders, rather than library folders
+  bool quick = false;
+  // Silent scans don't report progress, and don't interrupt other scans
+  bool silent = false;
+
+  bool operator==(const ScanRequest& request) const;
+};
+
+// Folders are read in a background thread, while the results are recognized
+// and applied to the database in batches on the UI thread. The window must
+// handle WM_TAIGA_SCANCALLBACK message and call Dispatch().
+class ScanService {
+public:
+  ~ScanService();
+
+  // Queues a scan, unless the same scan is already queued or running.
+  // Requests that are not silent interrupt the running scan.
+  void Request(ScanRequest request);
+  // Scans on the calling thread, and returns true if the anime or episode was
+  // found, along with the path it was found in. The running scan is
+  // interrupted, and resumed afterwards.
+  bool Run(const ScanRequest& request, std::wstring& path_found);
+  // Cancels the running scan and all queued scans
+  void Shutdown();
+
+  void Dispatch();
+
+  bool busy() const;
+  void SetWindowHandle(HWND hwnd);
+
+private:
+  struct Step {
+    std::wstring root;
+    base::FileSearchOptions options;
+    // Directories that are only walked through are not identified
+    bool identify_directories = true;
+  };
+
+  struct Plan {
+    // Anime folders to be validated before any of the steps
+    std::vector<std::pair<int, std::wstring>> folders;
+    std::vector<Step> steps;
+    // Index entries outside the walked folders are removed after a full scan
+    bool prune = false;
+    // Keys of the anime folders that the steps of a quick scan stand for
+    std::vector<std::wstring> anime_folders;
+  };
+
+  struct Batch {
+    unsigned int scan_id = 0;
+    size_t step = 0;
+    // Anime folders that were found to be missing, with the paths that were
+    // checked
+    std::vector<std::pair<int, std::wstring>> missing_folders;
+    std::vector<base::FileSearchResult> results;
+    std::vector<std::wstring> scanned_folders;
+    bool finished = false;
+  };
+
+  bool BuildPlan(const ScanRequest& request, Plan& plan) const;
+  void Prepare(const ScanRequest& request) const;
+  bool Apply(const Step& step, const std::vector<base::FileSearchResult>& results);
+  void StartNext();
+  void Stop();
+  void Finish(const std::vector<std::wstring>* scanned_folders);
+
+  void Work(unsigned int scan_id, Plan plan);
+  void Post(Batch& batch);
+
+  std::deque<ScanRequest> requests_;
+  std::optional<ScanRequest> running_;
+  unsigned int scan_id_ = 0;
+  Plan plan_;
+  size_t file_count_ = 0;
+  std::vector<std::wstring> directories_;
+
+  std::thread thread_;
+  std::atomic_bool cancelled_ = false;
+  std::deque<Batch> batches_;
+  std::condition_variable batch_taken_;
+  std::mutex mutex_;
+  HWND window_handle_ = nullptr;
+};
+
+inline ScanService scan_service;
+
+}  // namespace track
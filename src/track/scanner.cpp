@@ -23,40 +23,97 @@
 #include "base/string.h"
 #include "media/anime_db.h"
 #include "media/anime_util.h"
-#include "taiga/settings.h"
 #include "track/episode_util.h"
 #include "track/recognition.h"
-#include "ui/ui.h"
+#include "track/scan_service.h"
 
 namespace track {
 
-bool Scanner::OnDirectory(const base::FileSearchResult& result) {
-  static track::recognition::ParseOptions parse_options;
-  parse_options.parse_path = false;
-  parse_options.streaming_media = false;
+static ScanResult GetDirectoryScanResult(const anime::Episode& episode) {
+  ScanResult result;
+  if (anime::IsValidId(episode.anime_id) && Meow.IsValidAnimeType(episode))
+    result.anime_id = episode.anime_id;
+  return result;
+}
 
-  if (!Meow.Parse(result.name, parse_options, episode_)) {
-    LOGD(L"Could not parse directory: {}", result.name);
-    return false;
+static ScanResult GetFileScanResult(const anime::Episode& episode) {
+  ScanResult result;
+  if (anime::IsValidId(episode.anime_id) && Meow.IsValidAnimeType(episode) &&
+      Meow.IsValidFileExtension(episode)) {
+    result.anime_id = episode.anime_id;
+    result.episode_low = anime::GetEpisodeLow(episode);
+    result.episode_high = anime::GetEpisodeHigh(episode);
   }
+  return result;
+}
 
-  static track::recognition::MatchOptions match_options;
+static track::recognition::ParseOptions GetDirectoryParseOptions() {
+  track::recognition::ParseOptions parse_options;
+  parse_options.parse_path = false;
+  parse_options.streaming_media = false;
+  return parse_options;
+}
+
+static track::recognition::MatchOptions GetDirectoryMatchOptions() {
+  track::recognition::MatchOptions match_options;
   match_options.allow_sequels = false;
   match_options.check_airing_date = false;
   match_options.check_anime_type = false;
   match_options.check_episode_number = false;
   match_options.streaming_media = false;
+  return match_options;
+}
+
+static track::recognition::ParseOptions GetFileParseOptions() {
+  track::recognition::ParseOptions parse_options;
+  parse_options.parse_path = true;
+  parse_options.streaming_media = false;
+  return parse_options;
+}
+
+static track::recognition::MatchOptions GetFileMatchOptions() {
+  track::recognition::MatchOptions match_options;
+  match_options.allow_sequels = true;
+  match_options.check_airing_date = true;
+  match_options.check_anime_type = true;
+  match_options.check_episode_number = true;
+  match_options.streaming_media = false;
+  return match_options;
+}
+
+bool Scanner::OnDirectory(const base::FileSearchResult& result) {
+  const auto path = AddTrailingSlash(result.root) + result.name;
+
+  // Directories are recognized by their name alone, so their size and
+  // modification time are irrelevant
+  ScanResult scan_result;
+  if (!index_.Find(path, 0, 0, scan_result)) {
+    static const auto parse_options = GetDirectoryParseOptions();
+    static const auto match_options = GetDirectoryMatchOptions();
+
+    if (Meow.Parse(result.name, parse_options, episode_)) {
+      Meow.Identify(episode_, false, match_options);
+      scan_result = GetDirectoryScanResult(episode_);
+    } else {
+      LOGD(L"Could not parse directory: {}", result.name);
+    }
+
+    index_.Insert(path, 0, 0, scan_result);
+  }
 
-  Meow.Identify(episode_, false, match_options);
+  return OnDirectory(path, scan_result);
+}
 
-  const auto anime_item = anime::db.Find(episode_.anime_id);
+bool Scanner::OnDirectory(const std::wstring& path,
+                          const ScanResult& scan_result) {
+  const auto anime_item = anime::db.Find(scan_result.anime_id);
 
-  if (anime_item && Meow.IsValidAnimeType(episode_)) {
+  if (anime_item) {
     if (anime_item->GetFolder().empty())
-      anime_item->SetFolder(AddTrailingSlash(result.root) + result.name);
+      anime_item->SetFolder(path);
 
     if (anime_id_ && anime_id_.value() == anime_item->GetId()) {
-      path_found_ = AddTrailingSlash(result.root) + result.name;
+      path_found_ = path;
       if (options.skip_files)
         return true;
     }
@@ -68,36 +125,109 @@ bool Scanner::OnDirectory(const base::FileSearchResult& result) {
 bool Scanner::OnFile(const base::FileSearchResult& result) {
   const auto path = AddTrailingSlash(result.root) + result.name;
 
-  static track::recognition::ParseOptions parse_options;
-  parse_options.parse_path = true;
-  parse_options.streaming_media = false;
+  ScanResult scan_result;
+  if (!index_.Find(path, result.size, result.last_write_time, scan_result)) {
+    static const auto parse_options = GetFileParseOptions();
+    static const auto match_options = GetFileMatchOptions();
 
-  if (!Meow.Parse(path, parse_options, episode_)) {
-    LOGD(L"Could not parse filename: {}", result.name);
-    return false;
+    if (Meow.Parse(path, parse_options, episode_)) {
+      Meow.Identify(episode_, false, match_options);
+      scan_result = GetFileScanResult(episode_);
+    } else {
+      LOGD(L"Could not parse filename: {}", result.name);
+    }
+
+    index_.Insert(path, result.size, result.last_write_time, scan_result);
   }
 
-  static track::recognition::MatchOptions match_options;
-  match_options.allow_sequels = true;
-  match_options.check_airing_date = true;
-  match_options.check_anime_type = true;
-  match_options.check_episode_number = true;
-  match_options.streaming_media = false;
+  return OnEpisode(path, scan_result);
+}
 
-  Meow.Identify(episode_, false, match_options);
+void Scanner::Identify(const std::vector<base::FileSearchResult>& results,
+                       bool identify_directories,
+                       std::vector<ScanEntry>& entries) {
+  entries.clear();
+  entries.resize(results.size());
+
+  // Only the directories and files that are new or modified since the last
+  // scan are identified again. Directories are recognized by their name alone,
+  // so their size and modification time are irrelevant.
+  std::vector<size_t> directory_indexes;
+  std::vector<size_t> file_indexes;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    auto& entry = entries[i];
+    entry.path = AddTrailingSlash(result.root) + result.name;
+    entry.is_directory = result.is_directory;
+    if (result.is_directory) {
+      if (identify_directories && !index_.Find(entry.path, 0, 0, entry.result))
+        directory_indexes.push_back(i);
+    } else if (!index_.Find(entry.path, result.size, result.last_write_time,
+                            entry.result)) {
+      file_indexes.push_back(i);
+    }
+  }
+
+  if (!directory_indexes.empty()) {
+    static const auto parse_options = GetDirectoryParseOptions();
+    static const auto match_options = GetDirectoryMatchOptions();
 
-  const auto anime_item = anime::db.Find(episode_.anime_id);
+    std::vector<std::wstring> names;
+    names.reserve(directory_indexes.size());
+    for (const auto i : directory_indexes) {
+      names.push_back(results[i].name);
+    }
 
-  if (anime_item && Meow.IsValidAnimeType(episode_) &&
-      Meow.IsValidFileExtension(episode_)) {
-    const int upper_bound = anime::GetEpisodeHigh(episode_);
-    const int lower_bound = anime::GetEpisodeLow(episode_);
+    std::vector<anime::Episode> episodes;
+    Meow.IdentifyBatch(names, parse_options, match_options, episodes);
+
+    for (size_t j = 0; j < directory_indexes.size(); ++j) {
+      auto& entry = entries[directory_indexes[j]];
+      entry.result = GetDirectoryScanResult(episodes[j]);
+      index_.Insert(entry.path, 0, 0, entry.result);
+    }
+  }
+
+  if (!file_indexes.empty()) {
+    static const auto parse_options = GetFileParseOptions();
+    static const auto match_options = GetFileMatchOptions();
+
+    std::vector<std::wstring> paths;
+    paths.reserve(file_indexes.size());
+    for (const auto i : file_indexes) {
+      paths.push_back(entries[i].path);
+    }
+
+    std::vector<anime::Episode> episodes;
+    Meow.IdentifyBatch(paths, parse_options, match_options, episodes);
+
+    for (size_t j = 0; j < file_indexes.size(); ++j) {
+      const auto i = file_indexes[j];
+      auto& entry = entries[i];
+      entry.result = GetFileScanResult(episodes[j]);
+      index_.Insert(entry.path, results[i].size, results[i].last_write_time,
+                    entry.result);
+    }
+  }
+
+  LOGD(L"Found {} entries, {} of which were identified again.",
+       results.size(), directory_indexes.size() + file_indexes.size());
+}
+
+bool Scanner::OnEpisode(const std::wstring& path, const ScanResult& result) {
+  const auto anime_item = anime::db.Find(result.anime_id);
+
+  if (anime_item) {
+    const int upper_bound = result.episode_high;
+    const int lower_bound = result.episode_low;
 
     if (!anime::IsValidEpisodeNumber(upper_bound,
                                      anime_item->GetEpisodeCount()) ||
         !anime::IsValidEpisodeNumber(lower_bound,
                                      anime_item->GetEpisodeCount())) {
-      const auto episode_number = anime::GetEpisodeRange(episode_);
+      const auto episode_number =
+          anime::GetEpisodeRange(
+          anime::number_range_t{lower_bound, upper_bound});
       LOGD(L"Invalid episode number: {}\nFile: {}", episode_number, path);
       return false;
     }
@@ -123,7 +253,32 @@ bool Scanner::OnFile(const base::FileSearchResult& result) {
   return false;
 }
 
+bool Scanner::OnEntries(const std::vector<ScanEntry>& entries) {
+  for (const auto& entry : entries) {
+    if (entry.is_directory ? OnDirectory(entry.path, entry.result) :
+                             OnEpisode(entry.path, entry.result))
+      return true;
+  }
+
+  return false;
+}
+
 bool Scanner::Search(const std::wstring& root) {
+  // Without a target anime, the search never ends early. In that case we can
+  // collect the results first, and identify them all at once in parallel.
+  if (!anime_id_) {
+    std::vector<base::FileSearchResult> results;
+    const auto on_result = [&results](const base::FileSearchResult& result) {
+      results.push_back(result);
+      return false;
+    };
+    base::FileSearch::Search(root, on_result, on_result);
+    std::vector<ScanEntry> entries;
+    Identify(results, true, entries);
+    OnEntries(entries);
+    return false;
+  }
+
   return base::FileSearch::Search(root,
       [this](const base::FileSearchResult& result) {
         return OnDirectory(result);
@@ -134,6 +289,10 @@ bool Scanner::Search(const std::wstring& root) {
   );
 }
 
+ScanIndex& Scanner::index() {
+  return index_;
+}
+
 const std::wstring& Scanner::path_found() const {
   return path_found_;
 }
@@ -159,91 +318,16 @@ void Scanner::set_path_found(const std::wstring& path_found) {
 ////////////////////////////////////////////////////////////////////////////////
 
 void ScanAvailableEpisodes(bool silent) {
-  for (auto& [id, item] : anime::db.items) {
-    anime::ValidateFolder(item);
-  }
-
-  ScanAvailableEpisodes(silent, anime::ID_UNKNOWN, 0);
+  track::ScanRequest request;
+  request.silent = silent;
+  track::scan_service.Request(request);
 }
 
-void ScanAvailableEpisodes(bool silent, int anime_id, int episode_number) {
-  using track::scanner;
-
-  const auto library_folders = taiga::settings.GetLibraryFolders();
-
-  // Check if any library folder is available
-  if (!silent && library_folders.empty()) {
-    ui::OnSettingsLibraryFoldersEmpty();
-    return;
-  }
-
-  if (!silent) {
-    ui::taskbar_list.SetProgressState(TBPF_INDETERMINATE);
-    ui::SetSharedCursor(IDC_WAIT);
-    ui::ChangeStatusText(L"Scanning available episodes...");
-  }
-
-  scanner.set_anime_id(anime_id);
-  scanner.set_episode_number(episode_number);
-  // Casting file size threshold to int shouldn't be a problem, as the value
-  // is never supposed to exceed INT_MAX (i.e. ~2GB).
-  scanner.options.min_file_size =
-      taiga::settings.GetLibraryFileSizeThreshold();
-  scanner.set_path_found(L"");
-
-  auto anime_item = anime::db.Find(anime_id);
-  bool found = false;
-
-  if (anime_item) {
-    // Check if the anime folder still exists
-    anime::ValidateFolder(*anime_item);
-
-    // Search the anime folder for available episodes
-    if (!anime_item->GetFolder().empty()) {
-      scanner.options.skip_directories = true;
-      scanner.options.skip_files = false;
-      scanner.options.skip_subdirectories = false;
-      found = scanner.Search(anime_item->GetFolder());
-    }
-
-    // Search the cached episode path
-    if (!found && !anime_item->GetNextEpisodePath().empty()) {
-      const auto next_episode_path =
-          GetPathOnly(anime_item->GetNextEpisodePath());
-      if (!IsEqual(next_episode_path, anime_item->GetFolder())) {
-        scanner.options.skip_directories = true;
-        scanner.options.skip_files = false;
-        scanner.options.skip_subdirectories = true;
-        found = scanner.Search(next_episode_path);
-      }
-    }
-  }
-
-  if (!found) {
-    // Search library folders for available episodes
-    for (const auto& folder : library_folders) {
-      if (!FolderExists(folder))
-        continue;  // Might be a disconnected external drive
-      bool skip_directories = false;
-      if (anime_item && !anime_item->GetFolder().empty())
-        skip_directories = true;
-      scanner.options.skip_directories = skip_directories;
-      scanner.options.skip_files = false;
-      scanner.options.skip_subdirectories = false;
-      if (scanner.Search(folder)) {
-        found = true;
-        break;
-      }
-    }
-  }
-
-  if (!silent) {
-    ui::taskbar_list.SetProgressState(TBPF_NOPROGRESS);
-    ui::SetSharedCursor(IDC_ARROW);
-    ui::ClearStatusText();
-  }
-
-  ui::OnScanAvailableEpisodesFinished();
+void ScanAvailableEpisodes(bool silent, int anime_id) {
+  track::ScanRequest request;
+  request.anime_id = anime_id;
+  request.silent = silent;
+  track::scan_service.Request(request);
 }
 
 void ScanAvailableEpisodesQuick() {
@@ -251,30 +335,22 @@ void ScanAvailableEpisodesQuick() {
 }
 
 void ScanAvailableEpisodesQuick(int anime_id) {
-  using track::scanner;
-
-  for (auto it = anime::db.items.rbegin();
-       it != anime::db.items.rend(); ++it) {
-    anime::Item& anime_item = it->second;
-
-    if (anime_id != anime::ID_UNKNOWN && anime_item.GetId() != anime_id)
-      continue;
-
-    const auto folder = anime_item.GetFolder();
-
-    if (folder.empty() || !FolderExists(folder))
-      continue;
-
-    scanner.set_anime_id(anime_item.GetId());
-    scanner.set_episode_number(0);
-    scanner.options.min_file_size =
-        taiga::settings.GetLibraryFileSizeThreshold();
-    scanner.options.skip_directories = true;
-    scanner.options.skip_files = false;
-    scanner.options.skip_subdirectories = false;
+  track::ScanRequest request;
+  request.anime_id = anime_id;
+  request.quick = true;
+  request.silent = true;
+  track::scan_service.Request(request);
+}
 
-    scanner.Search(folder);
-  }
+bool ScanAvailableEpisodesNow(int anime_id, int episode_number) {
+  std::wstring path_found;
+  return ScanAvailableEpisodesNow(anime_id, episode_number, path_found);
+}
 
-  ui::OnScanAvailableEpisodesFinished();
+bool ScanAvailableEpisodesNow(int anime_id, int episode_number,
+                              std::wstring& path_found) {
+  track::ScanRequest request;
+  request.anime_id = anime_id;
+  request.episode_number = episode_number;
+  return track::scan_service.Run(request, path_found);
 }
@@ -20,16 +20,35 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "base/file_search.h"
 #include "track/episode.h"
+#include "track/scanner_index.h"
 
 namespace track {
 
+// A result of a search, along with what it was recognized as
+struct ScanEntry {
+  std::wstring path;
+  bool is_directory = false;
+  ScanResult result;
+};
+
 class Scanner : public base::FileSearch {
 public:
   bool Search(const std::wstring& root);
 
+  // Recognizes the results of a search that was made elsewhere. Only the
+  // entries that are not in the index are identified, in parallel through
+  // the reentrant functions of the engine.
+  void Identify(const std::vector<base::FileSearchResult>& results,
+                bool identify_directories, std::vector<ScanEntry>& entries);
+  // Applies recognized entries to the database, and returns true if the
+  // search should end
+  bool OnEntries(const std::vector<ScanEntry>& entries);
+
+  ScanIndex& index();
   const std::wstring& path_found() const;
 
   void set_anime_id(int anime_id);
@@ -38,11 +57,14 @@ public:
 
 private:
   bool OnDirectory(const base::FileSearchResult& result);
+  bool OnDirectory(const std::wstring& path, const ScanResult& result);
   bool OnFile(const base::FileSearchResult& result);
+  bool OnEpisode(const std::wstring& path, const ScanResult& result);
 
   std::optional<int> anime_id_;
   anime::Episode episode_;
   int episode_number_ = 0;
+  ScanIndex index_;
   std::wstring path_found_;
 };
 
@@ -50,7 +72,13 @@ inline Scanner scanner;
 
 }  // namespace track
 
+// These queue a scan in the background
 void ScanAvailableEpisodes(bool silent);
-void ScanAvailableEpisodes(bool silent, int anime_id, int episode_number);
+void ScanAvailableEpisodes(bool silent, int anime_id);
 void ScanAvailableEpisodesQuick();
 void ScanAvailableEpisodesQuick(int anime_id);
+
+// Scans on the calling thread, for when the result is needed right away
+bool ScanAvailableEpisodesNow(int anime_id, int episode_number);
+bool ScanAvailableEpisodesNow(int anime_id, int episode_number,
+                              std::wstring& path_found);
@@ -0,0 +1,181 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+
+#include "track/scanner_index.h"
+
+#include "base/file.h"
+#include "base/log.h"
+#include "base/string.h"
+#include "taiga/path.h"
+#include "track/recognition_snapshot.h"
+
+namespace track {
+
+using recognition::SnapshotReader;
+using recognition::SnapshotWriter;
+
+// Must be increased whenever the format or the meaning of results changes
+constexpr uint32_t kScanIndexVersion = 1;
+constexpr uint32_t kScanIndexMagic = 0x58444953;  // "SIDX"
+
+bool ScanIndex::Load(uint64_t stamp) {
+  if (!loaded_) {
+    loaded_ = true;
+    if (Read() && stamp_ == stamp)
+      return true;
+  } else if (stamp_ == stamp) {
+    return true;
+  }
+
+  if (!entries_.empty())
+    LOGD(L"Discarding {} results, as recognition has changed.",
+         entries_.size());
+
+  entries_.clear();
+  stamp_ = stamp;
+  modified_ = true;
+
+  return false;
+}
+
+bool ScanIndex::Read() {
+  FileMapping file;
+  if (!file.Open(taiga::GetPath(taiga::Path::DatabaseScanIndex)))
+    return false;
+
+  SnapshotReader reader{file.data(), file.size()};
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t char_size = 0;
+  uint32_t entry_count = 0;
+  if (!reader.Read(magic) || magic != kScanIndexMagic ||
+      !reader.Read(version) || version != kScanIndexVersion ||
+      !reader.Read(char_size) || char_size != sizeof(wchar_t) ||
+      !reader.Read(stamp_) || !reader.Read(entry_count)) {
+    return false;
+  }
+
+  entries_.reserve(entry_count);
+
+  for (uint32_t i = 0; i < entry_count; ++i) {
+    std::wstring path;
+    Entry entry;
+    int64_t last_write_time = 0;
+    if (!reader.Read(path) || !reader.Read(entry.size) ||
+        !reader.Read(last_write_time) ||
+        !reader.Read(entry.result.anime_id) ||
+        !reader.Read(entry.result.episode_low) ||
+        !reader.Read(entry.result.episode_high)) {
+      entries_.clear();
+      return false;
+    }
+    entry.last_write_time = static_cast<time_t>(last_write_time);
+    entries_.emplace(std::move(path), entry);
+  }
+
+  return true;
+}
+
+void ScanIndex::Save() {
+  if (!modified_)
+    return;
+
+  SnapshotWriter writer;
+  writer.Write(kScanIndexMagic);
+  writer.Write(kScanIndexVersion);
+  writer.Write(static_cast<uint32_t>(sizeof(wchar_t)));
+  writer.Write(stamp_);
+  writer.Write(static_cast<uint32_t>(entries_.size()));
+
+  for (const auto& [path, entry] : entries_) {
+    writer.Write(path);
+    writer.Write(entry.size);
+    writer.Write(static_cast<int64_t>(entry.last_write_time));
+    writer.Write(entry.result.anime_id);
+    writer.Write(entry.result.episode_low);
+    writer.Write(entry.result.episode_high);
+  }
+
+  // Write to a temporary file first, so that the index is never left
+  // half-written
+  const auto path = taiga::GetPath(taiga::Path::DatabaseScanIndex);
+  const auto temp_path = path + L".tmp";
+  if (SaveToFile(writer.data(), temp_path)) {
+    if (::MoveFileEx(temp_path.c_str(), path.c_str(),
+                     MOVEFILE_REPLACE_EXISTING)) {
+      modified_ = false;
+    }
+  }
+}
+
+bool ScanIndex::Find(const std::wstring& path, uint64_t size,
+                     time_t last_write_time, ScanResult& result) {
+  const auto it = entries_.find(path);
+  if (it == entries_.end())
+    return false;
+
+  auto& entry = it->second;
+  entry.found = true;
+
+  if (entry.size != size || entry.last_write_time != last_write_time)
+    return false;
+
+  result = entry.result;
+  return true;
+}
+
+void ScanIndex::Insert(const std::wstring& path, uint64_t size,
+                       time_t last_write_time, const ScanResult& result) {
+  auto& entry = entries_[path];
+  entry.size = size;
+  entry.last_write_time = last_write_time;
+  entry.result = result;
+  entry.found = true;
+
+  modified_ = true;
+}
+
+void ScanIndex::Prune(const std::vector<std::wstring>& folders) {
+  size_t count = 0;
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto& [path, entry] = *it;
+    if (!entry.found) {
+      const bool in_folder = std::any_of(folders.begin(), folders.end(),
+          [&path = path](const std::wstring& folder) {
+            return StartsWith(path, AddTrailingSlash(folder));
+          });
+      if (in_folder) {
+        it = entries_.erase(it);
+        ++count;
+        continue;
+      }
+    }
+    entry.found = false;
+    ++it;
+  }
+
+  if (count) {
+    LOGD(L"Removed {} results of files that no longer exist.", count);
+    modified_ = true;
+  }
+}
+
+}  // namespace track
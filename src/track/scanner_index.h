@@ -0,0 +1,73 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace track {
+
+// The outcome of recognizing a file or a directory, which is all that the
+// scanner needs to know about it
+struct ScanResult {
+  int anime_id = 0;
+  int episode_low = 0;
+  int episode_high = 0;
+};
+
+// Keeps the results of previous scans on disk, so that only new and modified
+// files need to be recognized again. Files are matched by their path, size and
+// modification time. All results are discarded when the recognition stamp
+// changes.
+class ScanIndex {
+public:
+  // Reads the index on first use. Returns false if the results were discarded.
+  bool Load(uint64_t stamp);
+  void Save();
+
+  bool Find(const std::wstring& path, uint64_t size, time_t last_write_time,
+            ScanResult& result);
+  void Insert(const std::wstring& path, uint64_t size, time_t last_write_time,
+              const ScanResult& result);
+
+  // Removes the entries under the given folders that were not found since the
+  // last call
+  void Prune(const std::vector<std::wstring>& folders);
+
+  size_t size() const { return entries_.size(); }
+
+private:
+  struct Entry {
+    uint64_t size = 0;
+    time_t last_write_time = 0;
+    ScanResult result;
+    bool found = false;
+  };
+
+  bool Read();
+
+  std::unordered_map<std::wstring, Entry> entries_;
+  uint64_t stamp_ = 0;
+  bool loaded_ = false;
+  bool modified_ = false;
+};
+
+}  // namespace track
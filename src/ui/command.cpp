@@ -348,7 +348,7 @@ void ExecuteCommand(const std::wstring& str, WPARAM wParam, LPARAM lParam) {
   //   Checks episode availability.
   } else if (command == L"ScanEpisodes") {
     int anime_id = static_cast<int>(lParam);
-    ScanAvailableEpisodes(false, anime_id, 0);
+    ScanAvailableEpisodes(false, anime_id);
   } else if (command == L"ScanEpisodesAll") {
     ScanAvailableEpisodes(false);
 
@@ -619,7 +619,7 @@ void ExecuteCommand(const std::wstring& str, WPARAM wParam, LPARAM lParam) {
     if (!anime_item || !anime_item->IsInList())
       return;
     if (!anime::ValidateFolder(*anime_item))
-      ScanAvailableEpisodes(false, anime_item->GetId(), 0);
+      ScanAvailableEpisodesNow(anime_item->GetId(), 0);
     const auto next_episode_path = anime_item->GetNextEpisodePath();
     if (!next_episode_path.empty()) {
       const auto anime_folder = anime_item->GetFolder();
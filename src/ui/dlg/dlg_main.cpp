@@ -44,6 +44,7 @@
 #include "track/feed_aggregator.h"
 #include "track/play.h"
 #include "track/recognition.h"
+#include "track/scan_service.h"
 #include "track/scanner.h"
 #include "ui/dialog.h"
 #include "ui/dlg/dlg_anime_info.h"
@@ -99,6 +100,9 @@ BOOL MainDialog::OnInitDialog() {
   // Refresh menus
   ui::Menus.UpdateAll();
 
+  // Receive the results of episode scans
+  track::scan_service.SetWindowHandle(GetWindowHandle());
+
   // Apply startup settings
   if (taiga::settings.GetSyncAutoOnStart()) {
     sync::Synchronize();
@@ -305,6 +309,12 @@ INT_PTR MainDialog::DialogProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPara
       return TRUE;
     }
 
+    // Apply the results of episode scans
+    case WM_TAIGA_SCANCALLBACK: {
+      track::scan_service.Dispatch();
+      return TRUE;
+    }
+
     // Show menu
     case WM_TAIGA_SHOWMENU: {
       toolbar_wm.ShowMenu();
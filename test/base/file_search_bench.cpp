@@ -0,0 +1,79 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+#include "base/file_search.h"
+
+#include "synthetic_tree.h"
+
+// Walks a synthetic tree of media files with each thread count, and reports
+// the best rate of a few runs. The page cache is warm after the first run, so
+// this measures the overhead of FileSearch rather than that of the disk.
+//
+//   file_search_bench [file_count]
+
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+  constexpr int kRuns = 3;
+
+  const size_t file_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                     : 50000;
+
+  const auto root = test::CreateTemporaryDirectory();
+  test::CreateSyntheticTree(root, file_count);
+
+  std::printf("%zu files\n", file_count);
+  std::printf("threads  best ms  files/s\n");
+
+  for (const size_t thread_count : {1, 2, 4, 8}) {
+    base::FileSearch file_search;
+    file_search.options.thread_count = thread_count;
+
+    double best_seconds = 0.0;
+    for (int run = 0; run < kRuns; ++run) {
+      size_t files = 0;
+      const auto t0 = std::chrono::steady_clock::now();
+      file_search.Search(root.wstring(), nullptr,
+          [&files](const base::FileSearchResult&) {
+            ++files;
+            return false;
+          });
+      const std::chrono::duration<double> seconds =
+          std::chrono::steady_clock::now() - t0;
+      if (files != file_count) {
+        std::printf("Found %zu files instead of %zu\n", files, file_count);
+        fs::remove_all(root);
+        return EXIT_FAILURE;
+      }
+      if (!run || seconds.count() < best_seconds)
+        best_seconds = seconds.count();
+    }
+
+    std::printf("%7zu  %7.1f  %7.0f\n", thread_count, best_seconds * 1000,
+                file_count / best_seconds);
+  }
+
+  fs::remove_all(root);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "base/file_search.h"
+
+#include "synthetic_tree.h"
+
+// Compares the results of FileSearch with std::filesystem on a synthetic tree,
+// with each of the options and thread counts.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Entry {
+  std::string path;
+  bool is_directory = false;
+  uint64_t size = 0;
+
+  bool operator<(const Entry& entry) const {
+    return std::tie(path, is_directory, size) <
+           std::tie(entry.path, entry.is_directory, entry.size);
+  }
+  bool operator==(const Entry& entry) const {
+    return std::tie(path, is_directory, size) ==
+           std::tie(entry.path, entry.is_directory, entry.size);
+  }
+};
+
+using entries_t = std::set<Entry>;
+
+std::string ToUtf8(const std::wstring& str) {
+  std::string output;
+  for (const auto c : str) {
+    const auto cp = static_cast<uint32_t>(c);
+    if (cp < 0x80) {
+      output.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      output.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      output.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      output.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+  return output;
+}
+
+// Adds the entries that the POSIX backend is expected to skip or follow
+void AddSpecialEntries(const fs::path& root) {
+  std::ofstream{root / ".hidden.mkv"} << "x";
+  fs::create_directories(root / ".hidden" / "Series");
+  std::ofstream{root / ".hidden" / "Series" / "Episode 1.mkv"} << "x";
+  fs::create_directory(root / "Empty");
+  fs::create_directory_symlink(root / "Series 1", root / "Link to folder");
+  fs::create_symlink(root / "Empty" / "Missing.mkv", root / "Broken link.mkv");
+  std::ofstream{root / "Target.mkv"} << std::string(40, 'x');
+  fs::create_symlink(root / "Target.mkv", root / "Link to file.mkv");
+}
+
+// Hidden entries and links to directories are skipped, and links to files
+// are followed, as documented in file_search_posix.cpp
+entries_t ReadExpected(const fs::path& root,
+                       const base::FileSearchOptions& options) {
+  entries_t entries;
+
+  for (auto it = fs::recursive_directory_iterator{root};
+       it != fs::recursive_directory_iterator{}; ++it) {
+    if (options.skip_subdirectories)
+      it.disable_recursion_pending();
+
+    const auto symlink_status = it->symlink_status();
+    if (it->path().filename().string().front() == '.') {
+      it.disable_recursion_pending();
+      continue;
+    }
+    if (fs::is_symlink(symlink_status) && !fs::is_regular_file(it->status()))
+      continue;
+
+    const bool is_directory = fs::is_directory(symlink_status);
+    if (is_directory) {
+      if (options.skip_directories)
+        continue;
+      entries.insert({it->path().string(), true, 0});
+    } else if (fs::is_regular_file(it->status())) {
+      const auto size = fs::file_size(it->path());
+      if (options.skip_files || size < options.min_file_size)
+        continue;
+      entries.insert({it->path().string(), false, size});
+    }
+  }
+
+  return entries;
+}
+
+entries_t Search(const fs::path& root, const base::FileSearchOptions& options,
+                 bool& stopped, size_t stop_after = 0) {
+  entries_t entries;
+
+  const auto add_entry = [&](const base::FileSearchResult& result) {
+    const auto path = base::detail::GetSubdirectoryPath(result.root,
+                                                        result.name);
+    entries.insert({ToUtf8(path), result.is_directory, result.size});
+    return stop_after && entries.size() >= stop_after;
+  };
+
+  base::FileSearch file_search;
+  file_search.options = options;
+  stopped = file_search.Search(fs::path{root}.wstring(), add_entry, add_entry);
+
+  return entries;
+}
+
+}  // namespace
+
+int main() {
+  const auto root = test::CreateTemporaryDirectory();
+  test::CreateSyntheticTree(root, 2000);
+  AddSpecialEntries(root);
+
+  struct Case {
+    const char* name;
+    base::FileSearchOptions options;
+  };
+  std::vector<Case> cases;
+  for (const size_t thread_count : {1, 2, 4, 8}) {
+    base::FileSearchOptions options;
+    options.log_errors = false;
+    options.thread_count = thread_count;
+    cases.push_back({"default", options});
+    options.skip_directories = true;
+    cases.push_back({"skip_directories", options});
+    options.skip_directories = false;
+    options.skip_files = true;
+    cases.push_back({"skip_files", options});
+    options.skip_files = false;
+    options.skip_subdirectories = true;
+    cases.push_back({"skip_subdirectories", options});
+    options.skip_subdirectories = false;
+    options.min_file_size = 32;
+    cases.push_back({"min_file_size", options});
+  }
+
+  int failures = 0;
+
+  for (const auto& [name, options] : cases) {
+    const auto expected = ReadExpected(root, options);
+    bool stopped = false;
+    const auto actual = Search(root, options, stopped);
+    const bool passed = actual == expected && !stopped;
+    std::printf("%s %s, %zu threads: %zu entries, %zu expected\n",
+                passed ? "PASS" : "FAIL", name, options.thread_count,
+                actual.size(), expected.size());
+    if (!passed)
+      ++failures;
+  }
+
+  // Searches stop as soon as a callback returns true
+  for (const size_t thread_count : {1, 4}) {
+    base::FileSearchOptions options;
+    options.thread_count = thread_count;
+    bool stopped = false;
+    const auto actual = Search(root, options, stopped, 10);
+    const bool passed = actual.size() == 10 && stopped;
+    std::printf("%s stop, %zu threads: %zu entries\n",
+                passed ? "PASS" : "FAIL", thread_count, actual.size());
+    if (!passed)
+      ++failures;
+  }
+
+  fs::remove_all(root);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/string.h"
+
+#include "string_reference.h"
+
+// Scores one query against many random titles with each similarity function,
+// the way ScoreTitle does, and reports the time per pair for the current and
+// the previous implementations.
+//
+//   string_bench [title_count]
+
+namespace {
+
+std::wstring GenerateTitle(std::mt19937& generator) {
+  static const std::wstring alphabet = L"abcdefghijklmnopqrstuvwxyz 0123";
+  std::wstring str(8 + generator() % 41, L' ');
+  for (auto& c : str) {
+    c = alphabet[generator() % alphabet.size()];
+  }
+  return str;
+}
+
+template <typename Function>
+double Measure(const std::vector<std::wstring>& titles,
+               const std::wstring& query, Function&& function) {
+  constexpr int kRuns = 3;
+
+  double best_seconds = 0.0;
+  volatile double sink = 0.0;
+
+  for (int run = 0; run < kRuns; ++run) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto& title : titles) {
+      sink = sink + static_cast<double>(function(title, query));
+    }
+    const std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - t0;
+    if (!run || seconds.count() < best_seconds)
+      best_seconds = seconds.count();
+  }
+
+  return best_seconds * 1e9 / titles.size();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t title_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                      : 20000;
+
+  std::mt19937 generator{42};
+  std::vector<std::wstring> titles(title_count);
+  for (auto& title : titles) {
+    title = GenerateTitle(generator);
+  }
+  const auto query = GenerateTitle(generator);
+
+  using namespace test;
+
+  std::printf("%zu titles\n", title_count);
+  std::printf("function        ns/pair  before\n");
+  std::printf("LCS             %7.0f  %6.0f\n",
+              Measure(titles, query, LongestCommonSubsequenceLength),
+              Measure(titles, query, reference::LongestCommonSubsequenceLength));
+  std::printf("Jaro-Winkler    %7.0f  %6.0f\n",
+              Measure(titles, query, JaroWinklerDistance),
+              Measure(titles, query, reference::JaroWinklerDistance));
+  std::printf("Levenshtein     %7.0f  %6.0f\n",
+              Measure(titles, query, LevenshteinDistance),
+              Measure(titles, query, reference::LevenshteinDistance));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Similarity functions of base/string.cpp as they were before the bit-parallel
+// kernels, for comparison in tests and benchmarks
+
+namespace test::reference {
+
+inline size_t LongestCommonSubsequenceLength(const std::wstring& str1,
+                                             const std::wstring& str2) {
+  if (str1.empty() || str2.empty())
+    return 0;
+
+  const size_t len1 = str1.length();
+  const size_t len2 = str2.length();
+
+  std::vector<std::vector<size_t>> table(len1 + 1);
+  for (auto it = table.begin(); it != table.end(); ++it)
+    it->resize(len2 + 1);
+
+  for (size_t i = 0; i < len1; i++) {
+    for (size_t j = 0; j < len2; j++) {
+      if (str1[i] == str2[j]) {
+        table[i + 1][j + 1] = table[i][j] + 1;
+      } else {
+        table[i + 1][j + 1] = std::max(table[i + 1][j], table[i][j + 1]);
+      }
+    }
+  }
+
+  return table.back().back();
+}
+
+inline double JaroWinklerDistance(const std::wstring& str1,
+                                  const std::wstring& str2) {
+  const int len1 = static_cast<int>(str1.size());
+  const int len2 = static_cast<int>(str2.size());
+
+  if (!len1 || !len2)
+    return 0.0;
+
+  int i, j, l;
+  int m = 0, t = 0;
+  std::vector<int> sflags(len1), aflags(len2);
+
+  // Calculate matching characters
+  int range = std::max(0, (std::max(len1, len2) / 2) - 1);
+  for (i = 0; i < len2; i++) {
+    for (j = std::max(i - range, 0), l = std::min(i + range + 1, len1); j < l; j++) {
+      if (str2[i] == str1[j] && !sflags[j]) {
+        sflags[j] = 1;
+        aflags[i] = 1;
+        m++;
+        break;
+      }
+    }
+  }
+  if (!m)
+    return 0.0;
+
+  // Calculate character transpositions
+  l = 0;
+  for (i = 0; i < len2; i++) {
+    if (aflags[i] == 1) {
+      for (j = l; j < len1; j++) {
+        if (sflags[j] == 1) {
+          l = j + 1;
+          break;
+        }
+      }
+      if (str2[i] != str1[j])
+        t++;
+    }
+  }
+  t /= 2;
+
+  // Jaro distance
+  double dw = ((static_cast<double>(m) / len1) +
+               (static_cast<double>(m) / len2) +
+               (static_cast<double>(m - t) / m)) / 3.0;
+
+  // Calculate common string prefix up to 4 chars
+  l = 0;
+  for (i = 0; i < std::min(std::min(len1, len2), 4); i++)
+    if (str1[i] == str2[i])
+        l++;
+
+  // Jaro-Winkler distance
+  const double scaling_factor = 0.1;
+  dw = dw + (l * scaling_factor * (1.0 - dw));
+
+  return dw;
+}
+
+inline double LevenshteinDistance(const std::wstring& str1,
+                                  const std::wstring& str2) {
+  const size_t len1 = str1.size();
+  const size_t len2 = str2.size();
+
+  std::vector<size_t> prev_col(len2 + 1);
+  for (size_t i = 0; i < prev_col.size(); i++)
+    prev_col[i] = i;
+
+  std::vector<size_t> col(len2 + 1);
+
+  for (size_t i = 0; i < len1; i++) {
+    col[0] = i + 1;
+
+    for (size_t j = 0; j < len2; j++)
+      col[j + 1] = std::min(std::min(1 + col[j], 1 + prev_col[1 + j]),
+                            prev_col[j] + (str1[i] == str2[j] ? 0 : 1));
+
+    col.swap(prev_col);
+  }
+
+  const double len = static_cast<double>(std::max(str1.size(), str2.size()));
+  return 1.0 - (prev_col[len2] / len);
+}
+
+}  // namespace test::reference
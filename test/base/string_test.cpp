@@ -0,0 +1,122 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/string.h"
+
+#include "string_reference.h"
+
+// Compares the bit-parallel similarity functions with the straightforward
+// implementations that they replaced. Results must be identical, including the
+// floating-point ones.
+
+namespace {
+
+// Random strings of a small alphabet, so that they have plenty of characters
+// in common. Characters above the lookup table of the kernels are included.
+std::wstring GenerateString(std::mt19937& generator, size_t max_length) {
+  static const std::wstring alphabet = L"abcde fgh12\u00E9\u3042\u30A2";
+  std::wstring str(generator() % (max_length + 1), L' ');
+  for (auto& c : str) {
+    c = alphabet[generator() % alphabet.size()];
+  }
+  return str;
+}
+
+// Both functions divide by zero for a pair of empty strings
+bool Equal(double value1, double value2) {
+  return value1 == value2 || (std::isnan(value1) && std::isnan(value2));
+}
+
+struct Failures {
+  size_t lcs = 0;
+  size_t jaro_winkler = 0;
+  size_t levenshtein = 0;
+};
+
+void Compare(const std::wstring& str1, const std::wstring& str2,
+             Failures& failures) {
+  if (LongestCommonSubsequenceLength(str1, str2) !=
+      test::reference::LongestCommonSubsequenceLength(str1, str2))
+    ++failures.lcs;
+  if (!Equal(JaroWinklerDistance(str1, str2),
+             test::reference::JaroWinklerDistance(str1, str2)))
+    ++failures.jaro_winkler;
+  if (!Equal(LevenshteinDistance(str1, str2),
+             test::reference::LevenshteinDistance(str1, str2)))
+    ++failures.levenshtein;
+}
+
+int Report(const char* name, size_t count, const Failures& failures) {
+  int result = 0;
+  const auto report = [&](const char* function, size_t failed) {
+    std::printf("%s %s, %s: %zu pairs, %zu failed\n",
+                failed ? "FAIL" : "PASS", function, name, count, failed);
+    if (failed)
+      result = 1;
+  };
+  report("LongestCommonSubsequenceLength", failures.lcs);
+  report("JaroWinklerDistance", failures.jaro_winkler);
+  report("LevenshteinDistance", failures.levenshtein);
+  return result;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 generator{42};
+  int failures = 0;
+
+  // Pairs of every length up to a few blocks of 64 characters, in both orders
+  {
+    Failures pair_failures;
+    size_t count = 0;
+    for (size_t i = 0; i < 20000; ++i) {
+      const auto str1 = GenerateString(generator, i % 2 ? 70 : 200);
+      const auto str2 = GenerateString(generator, i % 3 ? 70 : 200);
+      Compare(str1, str2, pair_failures);
+      Compare(str2, str1, pair_failures);
+      count += 2;
+    }
+    failures += Report("random pairs", count, pair_failures);
+  }
+
+  // A few queries against many titles, as when scoring titles, so that the
+  // masks of a query are reused and then replaced by those of the next one
+  {
+    Failures query_failures;
+    size_t count = 0;
+    for (size_t i = 0; i < 20; ++i) {
+      const auto query = GenerateString(generator, i % 4 ? 48 : 130);
+      for (size_t j = 0; j < 2000; ++j) {
+        const auto title = GenerateString(generator, 48);
+        Compare(title, query, query_failures);
+        ++count;
+      }
+    }
+    failures += Report("queries", count, query_failures);
+  }
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace test {
+
+namespace fs = std::filesystem;
+
+// Creates a new directory under the temporary directory of the system
+inline fs::path CreateTemporaryDirectory() {
+  auto path = (fs::temp_directory_path() / "taiga-XXXXXX").string();
+  if (!::mkdtemp(path.data()))
+    throw std::runtime_error{"Could not create a temporary directory"};
+  return path;
+}
+
+// Creates a tree that looks like a library of anime episodes, with a folder
+// for each series and some of them split into seasons. Every eighth folder
+// has a non-ASCII name. Returns the total size of the files.
+inline uint64_t CreateSyntheticTree(const fs::path& root, size_t file_count) {
+  std::mt19937 rng{1};
+  uint64_t total_size = 0;
+
+  for (size_t series = 1, files = 0; files < file_count; ++series) {
+    auto title = "Series " + std::to_string(series);
+    if (series % 8 == 0)
+      title += u8" \u00C9t\u00E9 \u3042";
+    auto folder = root / title;
+    if (rng() % 3 == 0)
+      folder /= "Season " + std::to_string(1 + rng() % 3);
+    fs::create_directories(folder);
+
+    const size_t episodes = 1 + rng() % 26;
+    for (size_t i = 1; i <= episodes && files < file_count; ++i, ++files) {
+      const auto filename = "[Group] " + title + " - " + std::to_string(i) +
+                            " [1080p].mkv";
+      const size_t size = rng() % 64;
+      std::ofstream{folder / filename} << std::string(size, 'x');
+      total_size += size;
+    }
+  }
+
+  return total_size;
+}
+
+}  // namespace test
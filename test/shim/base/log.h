@@ -0,0 +1,59 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Replaces base/log.h in the test targets, which are built without fmt and
+// monolog. Arguments are written in place of the "{}" fields, in order.
+
+namespace base {
+
+inline void FormatLog(std::wostringstream& stream, const wchar_t* str) {
+  stream << str;
+}
+
+template <class T, class... Args>
+void FormatLog(std::wostringstream& stream, const wchar_t* str,
+               const T& arg, const Args&... args) {
+  for (; *str; ++str) {
+    if (str[0] == L'{' && str[1] == L'}') {
+      stream << arg;
+      FormatLog(stream, str + 2, args...);
+      return;
+    }
+    stream << *str;
+  }
+}
+
+template <class... Args>
+void Log(const wchar_t* level, const wchar_t* str, const Args&... args) {
+  std::wostringstream stream;
+  FormatLog(stream, str, args...);
+  std::wcerr << level << L": " << stream.str() << std::endl;
+}
+
+}  // namespace base
+
+#define LOGD(text, ...) base::Log(L"Debug", text, __VA_ARGS__)
+#define LOGI(text, ...) base::Log(L"Informational", text, __VA_ARGS__)
+#define LOGW(text, ...) base::Log(L"Warning", text, __VA_ARGS__)
+#define LOGE(text, ...) base::Log(L"Error", text, __VA_ARGS__)
@@ -0,0 +1,97 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+
+#include <windows.h>
+
+namespace {
+
+// Returns the number of code units that were written, or would be written if
+// the output is null
+template <typename Char, typename Function>
+int Convert(const Char* str, int length, Function&& convert) {
+  const size_t size = length < 0 ? std::char_traits<Char>::length(str) + 1
+                                 : static_cast<size_t>(length);
+  return convert(str, str + size);
+}
+
+}  // namespace
+
+int MultiByteToWideChar(UINT, ULONG, const char* str, int length,
+                        wchar_t* output, int output_length) {
+  return Convert(str, length, [&](const char* it, const char* end) {
+    int count = 0;
+    while (it < end) {
+      const auto c = static_cast<unsigned char>(*it++);
+      uint32_t code_point = c;
+      int continuation = 0;
+      if (c >= 0xF0) {
+        code_point = c & 0x07;
+        continuation = 3;
+      } else if (c >= 0xE0) {
+        code_point = c & 0x0F;
+        continuation = 2;
+      } else if (c >= 0xC0) {
+        code_point = c & 0x1F;
+        continuation = 1;
+      }
+      for (; continuation && it < end; --continuation) {
+        code_point = (code_point << 6) | (static_cast<unsigned char>(*it++) & 0x3F);
+      }
+      if (output) {
+        if (count >= output_length)
+          return 0;
+        output[count] = static_cast<wchar_t>(code_point);
+      }
+      ++count;
+    }
+    return count;
+  });
+}
+
+int WideCharToMultiByte(UINT, ULONG, const wchar_t* str, int length,
+                        char* output, int output_length, const char*, int*) {
+  return Convert(str, length, [&](const wchar_t* it, const wchar_t* end) {
+    int count = 0;
+    const auto put = [&](uint32_t c) {
+      if (output && count < output_length)
+        output[count] = static_cast<char>(c);
+      ++count;
+    };
+    for (; it < end; ++it) {
+      const auto code_point = static_cast<uint32_t>(*it);
+      if (code_point < 0x80) {
+        put(code_point);
+      } else if (code_point < 0x800) {
+        put(0xC0 | (code_point >> 6));
+        put(0x80 | (code_point & 0x3F));
+      } else if (code_point < 0x10000) {
+        put(0xE0 | (code_point >> 12));
+        put(0x80 | ((code_point >> 6) & 0x3F));
+        put(0x80 | (code_point & 0x3F));
+      } else {
+        put(0xF0 | (code_point >> 18));
+        put(0x80 | ((code_point >> 12) & 0x3F));
+        put(0x80 | ((code_point >> 6) & 0x3F));
+        put(0x80 | (code_point & 0x3F));
+      }
+    }
+    return output && count > output_length ? 0 : count;
+  });
+}
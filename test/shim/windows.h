@@ -0,0 +1,83 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+
+// Replaces windows.h in the test targets. Only the types and functions that
+// base/string.cpp uses are declared, and wide strings are UTF-32 rather than
+// UTF-16.
+
+using INT = int;
+using UINT = unsigned int;
+using ULONG = unsigned long;
+using INT64 = long long;
+using UINT64 = unsigned long long;
+
+#define MAX_PATH 260
+#define CP_UTF8 65001
+
+// Convert between UTF-8 and UTF-32, regardless of the code page. A length of
+// -1 includes the null terminator.
+int MultiByteToWideChar(UINT code_page, ULONG flags, const char* str,
+                        int length, wchar_t* output, int output_length);
+int WideCharToMultiByte(UINT code_page, ULONG flags, const wchar_t* str,
+                        int length, char* output, int output_length,
+                        const char* default_char, int* used_default_char);
+
+inline int _wcsnicmp(const wchar_t* str1, const wchar_t* str2, size_t count) {
+  return wcsncasecmp(str1, str2, count);
+}
+
+inline double _wtof(const wchar_t* str) {
+  return std::wcstod(str, nullptr);
+}
+inline int _wtoi(const wchar_t* str) {
+  return static_cast<int>(std::wcstol(str, nullptr, 10));
+}
+inline INT64 _wtoi64(const wchar_t* str) {
+  return std::wcstoll(str, nullptr, 10);
+}
+inline INT64 _atoi64(const char* str) {
+  return std::strtoll(str, nullptr, 10);
+}
+
+inline int _ltoa_s(long value, char* buffer, size_t size, int) {
+  std::snprintf(buffer, size, "%ld", value);
+  return 0;
+}
+inline int _ltow_s(long value, wchar_t* buffer, size_t size, int) {
+  std::swprintf(buffer, size, L"%ld", value);
+  return 0;
+}
+inline int _ultow_s(unsigned long value, wchar_t* buffer, size_t size, int) {
+  std::swprintf(buffer, size, L"%lu", value);
+  return 0;
+}
+inline int _i64tow_s(INT64 value, wchar_t* buffer, size_t size, int) {
+  std::swprintf(buffer, size, L"%lld", value);
+  return 0;
+}
+inline int _ui64tow_s(UINT64 value, wchar_t* buffer, size_t size, int) {
+  std::swprintf(buffer, size, L"%llu", value);
+  return 0;
+}
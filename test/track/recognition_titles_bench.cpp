@@ -0,0 +1,126 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "track/recognition_titles.h"
+
+// Fills the six title dictionaries of the engine from a synthetic database,
+// then re-indexes random items as UpdateTitles(item, true) does: each item's
+// ID is erased from the dictionaries, and its titles are inserted again. The
+// same is done with the std::map that the dictionaries replaced, where the ID
+// is erased from every title. That takes much longer, so fewer items are
+// re-indexed.
+//
+//   recognition_titles_bench [item_count]
+
+namespace {
+
+using clock_t = std::chrono::steady_clock;
+using milliseconds_t =
+    std::chrono::duration<double, std::chrono::milliseconds::period>;
+
+constexpr size_t kDictionaryCount = 6;
+constexpr size_t kReindexCount = 1000;
+constexpr size_t kMapReindexCount = 20;
+
+std::wstring GenerateTitle(std::mt19937& generator, size_t id) {
+  static const std::vector<std::wstring> words{
+    L"kimi", L"no", L"shiranai", L"monogatari", L"sora", L"hoshi", L"yume",
+    L"tenshi", L"gakuen", L"senki", L"2", L"season", L"ova", L"movie",
+  };
+  std::wstring title;
+  for (size_t i = 1 + generator() % 4; i; --i) {
+    title += words[generator() % words.size()] + L" ";
+  }
+  return title + std::to_wstring(id % 7000);
+}
+
+// Returns the time per item in microseconds
+template <typename Reindex>
+double Measure(const std::vector<size_t>& ids, size_t count,
+               Reindex&& reindex) {
+  const auto t0 = clock_t::now();
+  for (size_t i = 0; i < count; ++i) {
+    reindex(ids[i]);
+  }
+  return milliseconds_t{clock_t::now() - t0}.count() * 1000 / count;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t item_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                     : 30000;
+
+  std::mt19937 generator{3};
+
+  // Each item has a title in each dictionary
+  std::vector<std::array<std::wstring, kDictionaryCount>> items(item_count);
+  for (size_t id = 0; id < item_count; ++id) {
+    for (auto& title : items[id]) {
+      title = GenerateTitle(generator, id);
+    }
+  }
+
+  std::vector<size_t> ids(kReindexCount);
+  for (auto& id : ids) {
+    id = generator() % item_count;
+  }
+
+  std::array<track::recognition::TitleDictionary, kDictionaryCount>
+      dictionaries;
+  std::array<std::map<std::wstring, std::set<int>>, kDictionaryCount> maps;
+  for (size_t id = 0; id < item_count; ++id) {
+    for (size_t i = 0; i < kDictionaryCount; ++i) {
+      dictionaries[i].Insert(items[id][i], static_cast<int>(id));
+      maps[i][items[id][i]].insert(static_cast<int>(id));
+    }
+  }
+
+  const auto dictionary_us = Measure(ids, kReindexCount, [&](size_t id) {
+    for (size_t i = 0; i < kDictionaryCount; ++i) {
+      dictionaries[i].Erase(static_cast<int>(id));
+      dictionaries[i].Insert(items[id][i], static_cast<int>(id));
+    }
+  });
+
+  const auto map_us = Measure(ids, kMapReindexCount, [&](size_t id) {
+    for (size_t i = 0; i < kDictionaryCount; ++i) {
+      for (auto& [title, title_ids] : maps[i]) {
+        title_ids.erase(static_cast<int>(id));
+      }
+      maps[i][items[id][i]].insert(static_cast<int>(id));
+    }
+  });
+
+  std::printf("%zu items\n", item_count);
+  std::printf("container        us/item\n");
+  std::printf("TitleDictionary  %7.1f\n", dictionary_us);
+  std::printf("std::map         %7.1f\n", map_us);
+
+  return EXIT_SUCCESS;
+}
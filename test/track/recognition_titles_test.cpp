@@ -0,0 +1,134 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "track/recognition_titles.h"
+
+// Compares TitleDictionary with a std::map of titles to IDs, under random
+// inserts and erases like those of UpdateTitles.
+
+namespace {
+
+using track::recognition::TitleDictionary;
+using model_t = std::map<std::wstring, std::set<int>>;
+
+bool Equal(const TitleDictionary& dictionary, const model_t& model,
+           const std::vector<std::wstring>& titles) {
+  for (const auto& title : titles) {
+    const auto ids = dictionary.Find(title);
+    const auto it = model.find(title);
+    if (it == model.end()) {
+      if (ids)
+        return false;
+      continue;
+    }
+    if (!ids || !std::equal(ids->begin(), ids->end(),
+                            it->second.begin(), it->second.end()))
+      return false;
+  }
+  return dictionary.size() == model.size();
+}
+
+void Erase(model_t& model, int id) {
+  for (auto& [title, ids] : model) {
+    ids.erase(id);
+  }
+}
+
+bool Report(const char* name, bool passed) {
+  std::printf("%s %s\n", passed ? "PASS" : "FAIL", name);
+  return passed;
+}
+
+}  // namespace
+
+int main() {
+  constexpr size_t kTitleCount = 500;
+  constexpr int kIdCount = 300;
+
+  // Titles of different lengths, some of which are never inserted
+  std::vector<std::wstring> titles;
+  for (size_t i = 0; i < kTitleCount; ++i) {
+    titles.push_back(L"title " + std::to_wstring(i) +
+                     std::wstring(i % 40, L'x'));
+  }
+
+  std::mt19937 generator{1};
+  TitleDictionary dictionary;
+  model_t model;
+  bool passed = true;
+
+  // Titles are inserted for a few IDs each, so that some of them have more
+  // IDs than are kept inline, and IDs are erased from all of their titles
+  {
+    bool churn_passed = true;
+    for (size_t i = 0; i < 200000; ++i) {
+      const int id = static_cast<int>(generator() % kIdCount);
+      if (generator() % 3) {
+        const auto& title = titles[generator() % (kTitleCount * 4 / 5)];
+        dictionary.Insert(title, id);
+        model[title].insert(id);
+      } else {
+        dictionary.Erase(id);
+        Erase(model, id);
+      }
+      if (i % 1000 == 0 && !Equal(dictionary, model, titles))
+        churn_passed = false;
+    }
+    churn_passed = churn_passed && Equal(dictionary, model, titles);
+    passed &= Report("random inserts and erases", churn_passed);
+  }
+
+  // Lists that are emptied are reused, so there are never more than one for
+  // each title
+  passed &= Report("overflow lists are reused",
+                   dictionary.overflow_size() <= kTitleCount);
+
+  // Titles remain after all of their IDs are erased
+  {
+    for (int id = 0; id < kIdCount; ++id) {
+      dictionary.Erase(id);
+      Erase(model, id);
+    }
+    bool empty = Equal(dictionary, model, titles);
+    for (const auto& [title, ids] : model) {
+      const auto found = dictionary.Find(title);
+      empty = empty && found && found->empty();
+    }
+    passed &= Report("erase all IDs", empty);
+  }
+
+  {
+    dictionary.Clear();
+    model.clear();
+    dictionary.Insert(titles[0], 1);
+    model[titles[0]].insert(1);
+    passed &= Report("clear", Equal(dictionary, model, titles) &&
+                              dictionary.overflow_size() == 0);
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
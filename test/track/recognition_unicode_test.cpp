@@ -0,0 +1,95 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base/string.h"
+#include "track/recognition_unicode.h"
+
+// Compares the ASCII path of Unicode normalization with utf8proc.
+
+namespace {
+
+std::string Escape(const std::wstring& str) {
+  std::string escaped;
+  for (const auto c : str) {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "\\u%04X",
+                  static_cast<unsigned int>(c));
+    escaped += buffer;
+  }
+  return escaped;
+}
+
+std::vector<std::wstring> GenerateInputs() {
+  std::vector<std::wstring> inputs;
+
+  // Every pair of ASCII code points, which covers CR LF and embedded nulls,
+  // and every code point between letters
+  for (wchar_t c = 0; c < 0x80; ++c) {
+    for (wchar_t d = 0; d < 0x80; ++d) {
+      inputs.push_back({c, d});
+    }
+    inputs.push_back({L'A', c, L'b', L' ', c, L'Z'});
+  }
+
+  // Strings that are mostly ASCII must not take the fast path. The non-ASCII
+  // character is moved through every position, and some of them combine with
+  // the ASCII character before them.
+  for (const auto c : {L'\u0080', L'\u00C9', L'\u0301', L'\u200B',
+                       L'\u3042', L'\uFF21'}) {
+    for (size_t length = 1; length <= 40; ++length) {
+      for (size_t i = 0; i < length; ++i) {
+        std::wstring input;
+        for (size_t j = 0; j < length; ++j) {
+          input.push_back(j == i ? c : static_cast<wchar_t>(L'A' + j % 26));
+        }
+        inputs.push_back(std::move(input));
+      }
+    }
+  }
+
+  return inputs;
+}
+
+}  // namespace
+
+int main() {
+  const auto inputs = GenerateInputs();
+
+  size_t failures = 0;
+
+  for (const auto& input : inputs) {
+    auto expected = input;
+    auto actual = input;
+    track::recognition::MapUnicode(expected);
+    track::recognition::NormalizeUnicode(actual);
+    if (actual != expected) {
+      if (!failures++)
+        std::printf("Normalization differs for: %s\n", Escape(input).c_str());
+    }
+  }
+
+  std::printf("%s unicode normalization: %zu strings, %zu failed\n",
+              failures ? "FAIL" : "PASS", inputs.size(), failures);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+** Taiga
+** Copyright (C) 2010-2021, Eren Okka
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/string.h"
+#include "track/recognition_words.h"
+
+// Compares the word replacements of title normalization with the sequential
+// passes that they replaced, where each pattern is replaced in turn.
+
+namespace {
+
+void ConvertRomanNumbers(std::wstring& str) {
+  static const std::vector<std::pair<std::wstring, std::wstring>> numerals{
+    {L"2", L"II"}, {L"3", L"III"}, {L"4", L"IV"}, {L"5", L"V"},
+    {L"6", L"VI"}, {L"7", L"VII"}, {L"8", L"VIII"}, {L"9", L"IX"},
+    {L"11", L"XI"}, {L"12", L"XII"}, {L"13", L"XIII"},
+  };
+
+  for (const auto& numeral : numerals)
+    ReplaceString(str, 0, numeral.second, numeral.first, true, true);
+}
+
+void Transliterate(std::wstring& str) {
+  for (size_t i = 0; i < str.size(); ++i) {
+    auto& c = str[i];
+    switch (c) {
+      case L'@': c = L'a'; break;
+      case L'\u00D7': c = L'x'; break;
+      case L'\uA789': c = L':'; break;
+      case L'\u014C': str.replace(i, 1, L"ou"); break;
+      case L'\u014D': str.replace(i, 1, L"ou"); break;
+      case L'\u016B': str.replace(i, 1, L"uu"); break;
+    }
+  }
+
+  ReplaceString(str, 0, L"wa", L"ha", true, true);
+  ReplaceString(str, 0, L"e", L"he", true, true);
+  ReplaceString(str, 0, L"o", L"wo", true, true);
+}
+
+void ConvertOrdinalNumbers(std::wstring& str) {
+  static const std::vector<std::pair<std::wstring, std::wstring>> ordinals{
+    {L"1st", L"first"}, {L"2nd", L"second"}, {L"3rd", L"third"},
+    {L"4th", L"fourth"}, {L"5th", L"fifth"}, {L"6th", L"sixth"},
+    {L"7th", L"seventh"}, {L"8th", L"eighth"}, {L"9th", L"ninth"},
+  };
+
+  for (const auto& ordinal : ordinals)
+    ReplaceString(str, 0, ordinal.second, ordinal.first, true, true);
+}
+
+void ConvertSeasonNumbers(std::wstring& str) {
+  using season_t = std::vector<std::wstring>;
+  static const std::vector<std::pair<std::wstring, season_t>> values{
+    {L"1", {L"1st season", L"season 1", L"series 1", L"s1"}},
+    {L"2", {L"2nd season", L"season 2", L"series 2", L"s2"}},
+    {L"3", {L"3rd season", L"season 3", L"series 3", L"s3"}},
+    {L"4", {L"4th season", L"season 4", L"series 4", L"s4"}},
+    {L"5", {L"5th season", L"season 5", L"series 5", L"s5"}},
+    {L"6", {L"6th season", L"season 6", L"series 6", L"s6"}},
+  };
+
+  for (const auto& value : values)
+    for (const auto& season : value.second)
+      ReplaceString(str, 0, season, value.first, true, true);
+}
+
+void EraseUnnecessary(std::wstring& str) {
+  ReplaceString(str, 0, L"&", L"and", true, true);
+  ReplaceString(str, 0, L"the animation", L"", true, true);
+  ReplaceString(str, 0, L"the", L"", true, true);
+  ReplaceString(str, 0, L"episode", L"", true, true);
+  ReplaceString(str, 0, L"oad", L"ova", true, true);
+  ReplaceString(str, 0, L"oav", L"ova", true, true);
+  ReplaceString(str, 0, L"specials", L"sp", true, true);
+  ReplaceString(str, 0, L"special", L"sp", true, true);
+  ReplaceString(str, 0, L"(tv)", L"", true, true);
+}
+
+// Titles that are made of the patterns and the characters around them, so
+// that replacements overlap and form new patterns
+std::vector<std::wstring> GenerateTitles(size_t count) {
+  static const std::vector<std::wstring> words{
+    L"season", L"series", L"1st", L"2nd", L"first", L"second", L"s1", L"s2",
+    L"1", L"2", L"3", L"the", L"animation", L"&", L"and", L"(tv)", L"tv",
+    L"special", L"specials", L"oad", L"oav", L"episode", L"ii", L"II",
+    L"IV", L"XIII", L"wa", L"e", L"o", L"@", L"x", L"a", L"\u014Cban",
+    L"\u00D7", L"\uA789",
+  };
+  static const std::vector<std::wstring> separators{
+    L" ", L"", L"-", L"(", L")", L":", L"  ", L"\u00E9",
+  };
+
+  std::mt19937 generator{7};
+  std::vector<std::wstring> titles;
+  titles.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::wstring title;
+    const size_t length = 1 + generator() % 7;
+    for (size_t j = 0; j < length; ++j) {
+      title += words[generator() % words.size()];
+      title += separators[generator() % separators.size()];
+    }
+    titles.push_back(std::move(title));
+  }
+
+  return titles;
+}
+
+}  // namespace
+
+int main() {
+  auto titles = GenerateTitles(200000);
+  titles.insert(titles.begin(), {
+    // Replacements that form the pattern of a later rule
+    L"season 2nd season",
+    L"series second season",
+    L"the the animation",
+    L"the(tv)",
+    L"special specials (tv)",
+    L"&& & and",
+    L"s1 1st season season 1",
+    L"Title II: Wa e o @ \u014Cban \u00D7 Nisekoi\uA789",
+  });
+
+  size_t first_failures = 0;
+  size_t second_failures = 0;
+
+  for (const auto& title : titles) {
+    auto expected = title;
+    auto actual = title;
+    ConvertRomanNumbers(expected);
+    Transliterate(expected);
+    track::recognition::ConvertRomanNumbersAndTransliterate(actual);
+    if (actual != expected) {
+      if (!first_failures++)
+        std::printf("First stage differs for: %s\n", WstrToStr(title).c_str());
+      continue;
+    }
+
+    // The second stage works on lower case text
+    actual = ToLower_Copy(expected);
+    expected = actual;
+    ConvertOrdinalNumbers(expected);
+    ConvertSeasonNumbers(expected);
+    EraseUnnecessary(expected);
+    track::recognition::ConvertNumbersAndEraseUnnecessary(actual);
+    if (actual != expected) {
+      if (!second_failures++)
+        std::printf("Second stage differs for: %s\n", WstrToStr(title).c_str());
+    }
+  }
+
+  std::printf("%s roman numbers and transliteration: %zu titles, %zu failed\n",
+              first_failures ? "FAIL" : "PASS", titles.size(), first_failures);
+  std::printf("%s numbers and unnecessary words: %zu titles, %zu failed\n",
+              second_failures ? "FAIL" : "PASS", titles.size(),
+              second_failures);
+
+  return first_failures || second_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}